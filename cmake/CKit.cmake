@@ -52,6 +52,19 @@ MACRO(CKIT_GENERATE_CONTEXT _interface _provider)
 
 ENDMACRO(CKIT_GENERATE_CONTEXT)
 
+# For plugins providing more than one interface, the context file of
+# an additional interface is named after both
+MACRO(CKIT_GENERATE_EXTRA_CONTEXT _interface _provider)
+  set(_impl ${_provider}-${_interface}.context)
+  set(_infile ${CMAKE_SOURCE_DIR}/data/${_interface}.list)
+
+  ckit_generate(${_impl} ${_infile} ${_interface} ${_provider} xml)
+  ADD_CUSTOM_TARGET(${_provider}_${_interface}_properties ALL DEPENDS ${_impl})
+
+  install(FILES ${_impl} DESTINATION share/contextkit/providers)
+
+ENDMACRO(CKIT_GENERATE_EXTRA_CONTEXT)
+
 MACRO(CKIT_GENERATE_HEADER _interface)
   set(_impl ${_interface}.hpp)
   set(_provider UNKNOWN)
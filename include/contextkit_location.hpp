@@ -0,0 +1,210 @@
+#ifndef _CONTEXTKIT_LOCATION_HPP_
+#define _CONTEXTKIT_LOCATION_HPP_
+/*  -*- Mode: C++ -*-
+ *
+ * contextkit-meego
+ * Copyright © 2010, Intel Corporation.
+ *
+ * This program is licensed under the terms and conditions of the
+ * Apache License, version 2.0.  The full text of the Apache License is at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ */
+
+#include <QElapsedTimer>
+#include <QVariant>
+#include <QList>
+#include <MGConfItem>
+#include <math.h>
+
+/*
+ * One location sample, kept as plain values. Only fields with their
+ * bit set in \a fields are valid; partial fixes update just the fields
+ * they carry. Converted to the public QVariant form only on emission.
+ */
+struct LocationSample
+{
+    enum Field {
+        Latitude = 1 << 0,
+        Longitude = 1 << 1,
+        Altitude = 1 << 2,
+        Speed = 1 << 3,
+        Direction = 1 << 4,
+        Climb = 1 << 5,
+        PositionFields = Latitude | Longitude | Altitude,
+        CourseFields = Speed | Direction | Climb
+    };
+
+    LocationSample()
+        : fields(0)
+        , timestamp(0)
+        , latitude(0)
+        , longitude(0)
+        , altitude(0)
+        , speed(0)
+        , direction(0)
+        , climb(0)
+    {}
+
+    bool has(unsigned mask) const { return (fields & mask) == mask; }
+    bool hasPosition() const { return has(Latitude | Longitude); }
+    bool hasHeading() const { return has(Direction); }
+
+    void setPosition(unsigned valid, int time,
+                     double lat, double lon, double alt)
+    {
+        valid &= PositionFields;
+        if (!valid)
+            return;
+        timestamp = time;
+        if (valid & Latitude)
+            latitude = lat;
+        if (valid & Longitude)
+            longitude = lon;
+        if (valid & Altitude)
+            altitude = alt;
+        fields |= valid;
+    }
+
+    void setCourse(unsigned valid, int time,
+                   double spd, double dir, double clb)
+    {
+        valid &= CourseFields;
+        if (!valid)
+            return;
+        timestamp = time;
+        if (valid & Speed)
+            speed = spd;
+        if (valid & Direction)
+            direction = dir;
+        if (valid & Climb)
+            climb = clb;
+        fields |= valid;
+    }
+
+    // always [latitude, longitude, altitude]; an unknown altitude is NaN,
+    // as consumers index the list
+    QVariant coordinates() const
+    {
+        QList<QVariant> coords;
+        coords.append(QVariant(latitude));
+        coords.append(QVariant(longitude));
+        coords.append(QVariant((fields & Altitude) ? altitude : double(NAN)));
+        return coords;
+    }
+
+    QVariant heading() const
+    {
+        return QVariant(direction);
+    }
+
+    unsigned fields;
+    int timestamp;
+    double latitude;
+    double longitude;
+    double altitude;
+    double speed;
+    double direction;
+    double climb;
+};
+
+/*
+ * Decides which location samples are worth emitting. A position is
+ * emitted only if it moved at least minDistance metres from the last
+ * emitted one, a heading only if it turned at least minHeadingDelta
+ * degrees, and neither more often than once per minInterval ms. The
+ * first value after reset() is always accepted.
+ *
+ * Thresholds are read from gconf by load(), 0 disables a threshold.
+ */
+class LocationFilter
+{
+public:
+    LocationFilter()
+        : minDistance(10.0)
+        , minHeadingDelta(5.0)
+        , minInterval(1000)
+    {}
+
+    void load()
+    {
+        minDistance = setting("min_distance", minDistance).toDouble();
+        minHeadingDelta = setting("min_heading_delta", minHeadingDelta).toDouble();
+        minInterval = setting("min_interval", minInterval).toInt();
+    }
+
+    void reset()
+    {
+        resetPosition();
+        resetHeading();
+    }
+
+    void resetPosition() { lastPosition.fields = 0; }
+    void resetHeading() { lastHeading.fields = 0; }
+
+    bool acceptPosition(LocationSample const &sample)
+    {
+        if (!sample.hasPosition())
+            return false;
+        if (lastPosition.hasPosition()) {
+            if (positionTimer.elapsed() < minInterval)
+                return false;
+            if (distance(lastPosition, sample) < minDistance)
+                return false;
+        }
+        lastPosition = sample;
+        positionTimer.start();
+        return true;
+    }
+
+    bool acceptHeading(LocationSample const &sample)
+    {
+        if (!sample.hasHeading())
+            return false;
+        if (lastHeading.hasHeading()) {
+            if (headingTimer.elapsed() < minInterval)
+                return false;
+            if (headingDelta(lastHeading, sample) < minHeadingDelta)
+                return false;
+        }
+        lastHeading = sample;
+        headingTimer.start();
+        return true;
+    }
+
+private:
+
+    static QVariant setting(char const *name, QVariant const &defaultValue)
+    {
+        MGConfItem item(QString("/apps/contextkit/location/") + name);
+        return item.value(defaultValue);
+    }
+
+    // equirectangular approximation, good enough for small distances
+    static double distance(LocationSample const &a, LocationSample const &b)
+    {
+        static const double earthRadius = 6371000.0;
+        static const double rad = M_PI / 180.0;
+        double x = (b.longitude - a.longitude) * rad
+            * cos((a.latitude + b.latitude) * rad / 2);
+        double y = (b.latitude - a.latitude) * rad;
+        return earthRadius * sqrt(x * x + y * y);
+    }
+
+    static double headingDelta(LocationSample const &a, LocationSample const &b)
+    {
+        double d = fmod(fabs(b.direction - a.direction), 360.0);
+        return (d > 180.0) ? 360.0 - d : d;
+    }
+
+    double minDistance;
+    double minHeadingDelta;
+    int minInterval;
+
+    LocationSample lastPosition;
+    LocationSample lastHeading;
+    QElapsedTimer positionTimer;
+    QElapsedTimer headingTimer;
+};
+
+#endif // _CONTEXTKIT_LOCATION_HPP_
@@ -0,0 +1,212 @@
+#ifndef _COR_EVDEV_HPP_
+#define _COR_EVDEV_HPP_
+/*
+ * evdev capability bitmaps
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: Denis Zalevskiy <denis.zalevskiy@jollamobile.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <linux/input.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace cor {
+
+namespace evdev {
+
+/**
+ * Fixed size bitmap laid out as the kernel does it: an array of longs,
+ * bit N is bit (N % bits per long) of word (N / bits per long). So it
+ * can be filled directly by EVIOCGBIT/EVIOCGSW ioctls as well as
+ * parsed from sysfs "capabilities/..." attributes. The word type is
+ * only meant to be changed to check the layout of the other word size.
+ */
+template <unsigned Bits, typename Word = unsigned long>
+class Bitmap
+{
+public:
+    enum {
+        bits_per_word = sizeof(Word) * 8,
+        words_count = (Bits + bits_per_word - 1) / bits_per_word
+    };
+
+    Bitmap() { clear(); }
+
+    void clear() { memset(words, 0, sizeof(words)); }
+
+    /// for ioctls
+    Word *data() { return words; }
+    static size_t size() { return sizeof(words); }
+
+    bool test(unsigned bit) const
+    {
+        return bit < Bits
+            && ((words[bit / bits_per_word] >> (bit % bits_per_word)) & 1);
+    }
+
+    void set(unsigned bit)
+    {
+        if (bit < Bits)
+            words[bit / bits_per_word] |= (Word(1) << (bit % bits_per_word));
+    }
+
+    void reset(unsigned bit)
+    {
+        if (bit < Bits)
+            words[bit / bits_per_word] &= ~(Word(1) << (bit % bits_per_word));
+    }
+
+    /// all bits from first to last (inclusive) are set
+    bool test_range(unsigned first, unsigned last) const
+    {
+        if (first > last || last >= Bits)
+            return false;
+        unsigned w = first / bits_per_word, last_w = last / bits_per_word;
+        for (; w <= last_w; ++w) {
+            Word mask = ~Word(0);
+            if (w == first / bits_per_word)
+                mask &= ~Word(0) << (first % bits_per_word);
+            if (w == last_w)
+                mask &= ~Word(0) >> (bits_per_word - 1 - last % bits_per_word);
+            if ((words[w] & mask) != mask)
+                return false;
+        }
+        return true;
+    }
+
+    /// all bits set in mask are set here too
+    bool contains(Bitmap const &mask) const
+    {
+        for (unsigned i = 0; i < words_count; ++i)
+            if ((words[i] & mask.words[i]) != mask.words[i])
+                return false;
+        return true;
+    }
+
+    /// some bit set in other is set here too
+    bool intersects(Bitmap const &other) const
+    {
+        for (unsigned i = 0; i < words_count; ++i)
+            if (words[i] & other.words[i])
+                return true;
+        return false;
+    }
+
+    bool any() const
+    {
+        for (unsigned i = 0; i < words_count; ++i)
+            if (words[i])
+                return true;
+        return false;
+    }
+
+    /**
+     * Parses the sysfs form: hexadecimal words separated by spaces,
+     * the most significant one first, leading zero words omitted,
+     * e.g. "3 0 0 fffffffe". The string is parsed in place from its
+     * end, words beyond the bitmap size are ignored. On error the
+     * bitmap is left cleared and false is returned.
+     */
+    bool parse(char const *s)
+    {
+        clear();
+        if (!s)
+            return false;
+
+        char const *end = s + strlen(s);
+        unsigned w = 0;
+        while (true) {
+            while (end != s && is_space(end[-1]))
+                --end;
+            if (end == s)
+                break;
+
+            char const *begin = end;
+            while (begin != s && !is_space(begin[-1]))
+                --begin;
+            if (end - begin > int(bits_per_word / 4)) {
+                clear();
+                return false;
+            }
+
+            Word v = 0;
+            for (char const *p = begin; p != end; ++p) {
+                int d = hex_digit(*p);
+                if (d < 0) {
+                    clear();
+                    return false;
+                }
+                v = (v << 4) | d;
+            }
+            if (w < words_count)
+                words[w] = v;
+            ++w;
+            end = begin;
+        }
+        mask_tail();
+        return (w != 0);
+    }
+
+private:
+
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t';
+    }
+
+    static int hex_digit(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // bits beyond Bits in the last word are never set
+    void mask_tail()
+    {
+        if (Bits % bits_per_word)
+            words[words_count - 1] &= ~Word(0) >> (bits_per_word - Bits % bits_per_word);
+    }
+
+    Word words[words_count];
+};
+
+typedef Bitmap<KEY_MAX + 1> KeyBits;
+typedef Bitmap<SW_MAX + 1> SwitchBits;
+
+/// keys Q to P are available, so it looks like a real keyboard
+static inline bool has_qwerty_row(KeyBits const &keys)
+{
+    return keys.test_range(KEY_Q, KEY_P);
+}
+
+} // namespace evdev
+
+} // namespace cor
+
+#endif // _COR_EVDEV_HPP_
@@ -29,118 +29,235 @@
 
 #include <libudev.h>
 #include <stddef.h>
+#include <utility>
 
 namespace cor {
 
 namespace udev {
 
-class Root
+/**
+ * Owner of a libudev object reference: move-only, drops the reference
+ * when destroyed. Traits::unref() releases the reference.
+ */
+template <typename T, typename Traits>
+class Handle
 {
 public:
-    Root() : p(udev_new()) {}
-    ~Root()
+    explicit Handle(T *p = 0) : p(p) {}
+    Handle(Handle &&from) : p(from.p) { from.p = 0; }
+    ~Handle() { reset(); }
+
+    Handle & operator =(Handle &&from)
     {
-        if (p)
-            udev_unref(p);
+        if (this != &from) {
+            reset();
+            p = from.p;
+            from.p = 0;
+        }
+        return *this;
     }
 
+    Handle(Handle const &) = delete;
+    Handle & operator =(Handle const &) = delete;
+
     operator bool() const { return (p != 0); }
+    T *get() const { return p; }
 
-    udev_device *mk_device(char const *path)
+    void reset()
     {
-        return udev_device_new_from_syspath(p, path);
+        if (p)
+            Traits::unref(p);
+        p = 0;
     }
 
-    struct udev_enumerate *mk_enumerate()
+protected:
+    T *p;
+};
+
+struct RootTraits { static void unref(struct udev *p) { udev_unref(p); } };
+struct EnumerateTraits {
+    static void unref(struct udev_enumerate *p) { udev_enumerate_unref(p); }
+};
+struct MonitorTraits {
+    static void unref(struct udev_monitor *p) { udev_monitor_unref(p); }
+};
+struct DeviceTraits {
+    static void unref(struct udev_device *p) { udev_device_unref(p); }
+};
+
+class Root : public Handle<struct udev, RootTraits>
+{
+public:
+    Root() : Handle(udev_new()) {}
+    Root(Root &&from) : Handle(std::move(from)) {}
+};
+
+class ListEntry
+{
+public:
+    ListEntry(struct udev_list_entry *p)
+        : p(p) {}
+
+    /// calls fn(ListEntry) for each entry while fn returns true
+    template <typename T>
+    void for_each(T const &fn) const
     {
-        return udev_enumerate_new(p);
+        struct udev_list_entry *entry;
+        udev_list_entry_foreach(entry, p) {
+            if (!fn(ListEntry(entry)))
+                break;
+        }
+    }
+
+    char const *path() const
+    {
+        return udev_list_entry_get_name(p);
     }
 
 private:
-    struct udev *p;
+    struct udev_list_entry *p;
 };
 
-
-class Enumerate
+/**
+ * Devices matching all added filters; the filters of one kind are
+ * or-ed: two subsystems match devices of either one.
+ */
+class Enumerate : public Handle<struct udev_enumerate, EnumerateTraits>
 {
 public:
     Enumerate(Root &root)
-        : p(root.mk_enumerate())
+        : Handle(udev_enumerate_new(root.get()))
     {}
+    Enumerate(Enumerate &&from) : Handle(std::move(from)) {}
 
-    ~Enumerate()
+    void subsystem_add(char const *name)
     {
-        if (p)
-            udev_enumerate_unref(p);
+        udev_enumerate_add_match_subsystem(p, name);
     }
 
-    operator bool() const { return (p != 0); }
+    void sysname_add(char const *pattern)
+    {
+        udev_enumerate_add_match_sysname(p, pattern);
+    }
 
-    void subsystem_add(char const *name)
+    /// value == 0 matches all devices having the attribute
+    void sysattr_add(char const *name, char const *value = 0)
     {
-        udev_enumerate_add_match_subsystem(p, name);
+        udev_enumerate_add_match_sysattr(p, name, value);
     }
 
-    struct udev_list_entry *devices()
+    void property_add(char const *name, char const *value)
     {
-        udev_enumerate_scan_devices(p);
-        return udev_enumerate_get_list_entry(p);
+        udev_enumerate_add_match_property(p, name, value);
     }
 
-private:
-    struct udev_enumerate *p;
+    /// scans devices, the list is valid while this object lives
+    ListEntry devices()
+    {
+        udev_enumerate_scan_devices(p);
+        return ListEntry(udev_enumerate_get_list_entry(p));
+    }
 };
 
-class ListEntry
+class Monitor : public Handle<struct udev_monitor, MonitorTraits>
 {
 public:
-    ListEntry(Enumerate &e)
-        : p(e.devices()) {}
+    Monitor(Root &root, char const *name = "udev")
+        : Handle(udev_monitor_new_from_netlink(root.get(), name))
+    {}
+    Monitor(Monitor &&from) : Handle(std::move(from)) {}
 
-    ListEntry(struct udev_list_entry *p)
-        : p(p) {}
+    bool subsystem_add(char const *name, char const *devtype = 0)
+    {
+        return udev_monitor_filter_add_match_subsystem_devtype
+            (p, name, devtype) >= 0;
+    }
 
-    template <typename T>
-    void for_each(T const &fn)
+    /// starts receiving events, filters should be already added
+    bool enable()
     {
-        struct udev_list_entry *entry;
-        udev_list_entry_foreach(entry, p) {
-            if (!fn(ListEntry(entry)))
-                break;
-        }
+        return udev_monitor_enable_receiving(p) >= 0;
     }
 
-    char const *path() const
+    /// non-blocking socket to be watched for events
+    int fd() const
     {
-        return udev_list_entry_get_name(p);
+        return udev_monitor_get_fd(p);
     }
-private:
-    struct udev_list_entry *p;
 };
 
-
-class Device
+/**
+ * All string accessors return pointers owned by libudev, valid while
+ * the device lives, or null if there is no such value.
+ */
+class Device : public Handle<struct udev_device, DeviceTraits>
 {
 public:
+    explicit Device(struct udev_device *p = 0) : Handle(p) {}
+
     Device(Root &root, char const *path)
-        : p(root.mk_device(path))
+        : Handle(udev_device_new_from_syspath(root.get(), path))
     { }
 
-    operator bool() const { return (p != 0); }
+    /// next device event from the monitor, null if there is none
+    Device(Monitor &monitor)
+        : Handle(udev_monitor_receive_device(monitor.get()))
+    { }
 
-    ~Device()
+    Device(Device &&from) : Handle(std::move(from)) {}
+
+    Device & operator =(Device &&from)
+    {
+        Handle::operator =(std::move(from));
+        return *this;
+    }
+
+    /// closest ancestor of the subsystem (and devtype, if not 0)
+    Device parent_with_subsystem(char const *subsystem,
+                                 char const *devtype = 0) const
     {
-        if (!p)
-            udev_device_unref(p);
+        // the parent is owned by this device, take own reference
+        struct udev_device *parent = p
+            ? udev_device_get_parent_with_subsystem_devtype(p, subsystem, devtype)
+            : 0;
+        return Device(parent ? udev_device_ref(parent) : 0);
     }
 
     char const *attr(char const *name) const
     {
-        return udev_device_get_sysattr_value(p, name);
+        return p ? udev_device_get_sysattr_value(p, name) : 0;
     }
 
-private:
-    struct udev_device *p;
+    char const *property(char const *name) const
+    {
+        return p ? udev_device_get_property_value(p, name) : 0;
+    }
+
+    char const *path() const
+    {
+        return p ? udev_device_get_syspath(p) : 0;
+    }
+
+    char const *devnode() const
+    {
+        return p ? udev_device_get_devnode(p) : 0;
+    }
+
+    char const *subsystem() const
+    {
+        return p ? udev_device_get_subsystem(p) : 0;
+    }
+
+    char const *sysname() const
+    {
+        return p ? udev_device_get_sysname(p) : 0;
+    }
+
+    /// "add", "remove", "change"... for devices from the monitor
+    char const *action() const
+    {
+        return p ? udev_device_get_action(p) : 0;
+    }
 };
 
 } // namespace udev
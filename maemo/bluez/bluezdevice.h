@@ -22,56 +22,29 @@
 #ifndef BLUEZDEVICE_H
 #define BLUEZDEVICE_H
 
-#include <QDBusError>
-#include <QDBusObjectPath>
-#include <QDBusInterface>
-#include <QSet>
-#include <QMap>
-#include <QString>
+#include <QDBusConnection>
 
 #define BLUEZ_PLUGIN_BUS QDBusConnection::systemBus()
 
-class QDBusPendingCallWatcher;
-class AsyncDBusInterface; // From libcontextsubscriber-dev
-
 namespace ContextSubscriberBluez
 {
 
 /*!
-  \class BluezDevice
+  \struct BluezDevice
 
-  \brief A proxy class for Bluez D-Bus device interface.
+  \brief What BluezPlugin knows about a Bluez device.
 
+  A plain record: the PropertyChanged signals of all devices come
+  through one match rule in BluezPlugin, which dispatches them to the
+  records by object path.
  */
 
-class BluezDevice : public QObject
+struct BluezDevice
 {
-    Q_OBJECT
-
-public:
-    explicit BluezDevice(const QString& path);
-    ~BluezDevice();
-    bool isConnected() const;
-
-Q_SIGNALS:
-    void connectionStateChanged(bool status);
-
-private Q_SLOTS:
-    void onPropertyChanged(QString key, QDBusVariant value);
-    void getPropertiesFinished(QDBusPendingCallWatcher* pcw);
+    BluezDevice() : connected(false), known(false) {}
 
-private:
-    QDBusPendingCallWatcher* getPropertiesWatcher; ///< For watching the GetProperties D-Bus call
     bool connected; ///< Whether device is currently connected
-
-    QDBusObjectPath devicePath; ///< Object path of the Bluez device
-    AsyncDBusInterface* device; ///< Bluez Device interface
-
-    static const QString serviceName; ///< Bluez service name
-    static const QString deviceInterface; ///< Interface name of Bluez device
-    static QDBusConnection busConnection; ///< QDBusConnection used for talking with Bluez
-
-
+    bool known; ///< Whether connected has been reported by Bluez yet
 };
 }
 
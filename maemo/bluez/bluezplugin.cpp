@@ -22,6 +22,7 @@
 #include "bluezplugin.h"
 #include "bluezdevice.h"
 #include "sconnect.h"
+#include "dbussignaldemux.h"
 
 #include "logging.h"
 // This is for getting rid of synchronous D-Bus introspection calls Qt does.
@@ -30,6 +31,8 @@
 #include <QDBusServiceWatcher>
 #include <QDBusPendingReply>
 #include <QDBusPendingCallWatcher>
+#include <QDBusMessage>
+#include <QDBusArgument>
 
 #include <contextkit_props/bluetooth.hpp>
 
@@ -50,45 +53,97 @@ const QString BluezPlugin::managerPath = "/";
 const QString BluezPlugin::managerInterface = "org.bluez.Manager";
 const QString BluezPlugin::adapterInterface = "org.bluez.Adapter";
 const QString BluezPlugin::deviceInterface = "org.bluez.Device";
+const QString BluezPlugin::adapter1Interface = "org.bluez.Adapter1";
+const QString BluezPlugin::device1Interface = "org.bluez.Device1";
+const QString BluezPlugin::objectManagerInterface = "org.freedesktop.DBus.ObjectManager";
+const QString BluezPlugin::propertiesInterface = "org.freedesktop.DBus.Properties";
+
+/// Interfaces and their properties of one object, as in the BlueZ 5
+/// ObjectManager signals and GetManagedObjects
+typedef QMap<QString, QVariantMap> BluezInterfaces;
+
+/// Reads the a{sa{sv}} interfaces of one object. Decoded by hand, so
+/// BluezInterfaces needs no metatype.
+static BluezInterfaces readInterfaces(const QDBusArgument& arg)
+{
+    BluezInterfaces interfaces;
+    arg.beginMap();
+    while (!arg.atEnd()) {
+        QString name;
+        QVariantMap properties;
+        arg.beginMapEntry();
+        arg >> name >> properties;
+        arg.endMapEntry();
+        interfaces.insert(name, properties);
+    }
+    arg.endMap();
+    return interfaces;
+}
 
 BluezPlugin::BluezPlugin()
     : manager(0), adapter(0), status(NotConnected), serviceWatcher(0),
-      defaultAdapterWatcher(0), getPropertiesWatcher(0)
+      defaultAdapterWatcher(0), getPropertiesWatcher(0), connectedCount(0),
+      deviceSignals(0), managedObjectsWatcher(0), objectManagerSignals(0),
+      propertiesSignals(0)
 {
     // Create a mapping from Bluez properties to Context Properties
     properties["Powered"] = ckit::is_enabled;
     properties["Discoverable"] = ckit::is_visible;
     propertyCache[ckit::is_connected] = false;
 
+    lingerTimer.setSingleShot(true);
+    lingerTimer.setInterval(lingerTimeout);
+    sconnect(&lingerTimer, SIGNAL(timeout()), this, SLOT(disconnectFromBluez()));
+
     // We're ready to take in subscriptions right away; we'll connect to bluez
     // when we get subscriptions.
     QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
+/// Drops the connection to BlueZ: all the match rules, watchers and
+/// device records. Only propertyCache is kept; when we connect again,
+/// valueChanged is emitted for what has changed meanwhile.
 void BluezPlugin::disconnectFromBluez()
 {
+    contextDebug() << "Nobody subscribed for" << lingerTimeout << "ms, disconnecting from bluez";
     status = NotConnected;
-
-    // Disconnect D-Bus signals
-    BLUEZ_PLUGIN_BUS.disconnect(serviceName, managerPath,
-                             managerInterface, "DefaultAdapterChanged",
-                             this, SLOT(onDefaultAdapterChanged(QDBusObjectPath)));
-
-    BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
-                             adapterInterface, "PropertyChanged",
-                             this, SLOT(onPropertyChanged(QString, QDBusVariant)));
-
-    BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
-                          adapterInterface, "DeviceCreated",
-                          this, SLOT(onDeviceCreated(QDBusObjectPath)));
-
-    BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
-                          adapterInterface, "DeviceRemoved",
-                          this, SLOT(onDeviceRemoved(QDBusObjectPath)));
-
-    Q_FOREACH (const QDBusObjectPath& path, devicesList.keys()) {
-        onDeviceRemoved(path);
+    lingerTimer.stop();
+
+    if (manager)
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, managerPath,
+                                 managerInterface, "DefaultAdapterChanged",
+                                 this, SLOT(onDefaultAdapterChanged(QDBusObjectPath)));
+    if (adapter) {
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                                 adapterInterface, "PropertyChanged",
+                                 this, SLOT(onPropertyChanged(QString, QDBusVariant)));
+
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                              adapterInterface, "DeviceCreated",
+                              this, SLOT(onDeviceCreated(QDBusObjectPath)));
+
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                              adapterInterface, "DeviceRemoved",
+                              this, SLOT(onDeviceRemoved(QDBusObjectPath)));
     }
+    adapterPath.clear();
+
+    delete deviceSignals;
+    deviceSignals = 0;
+    delete objectManagerSignals;
+    objectManagerSignals = 0;
+    delete propertiesSignals;
+    propertiesSignals = 0;
+
+    // Without the signals the device records would go stale. They come
+    // back as disconnected on the next connect, and only a device which
+    // turns out to be connected is a transition then; so the cached
+    // Connected value must start from false too.
+    qDeleteAll(deviceCalls.keys());
+    deviceCalls.clear();
+    devicesList.clear();
+    connectedCount = 0;
+    updateConnected();
 
     delete adapter;
     adapter = 0;
@@ -97,18 +152,69 @@ void BluezPlugin::disconnectFromBluez()
     delete serviceWatcher;
     serviceWatcher = 0;
 
+    delete managedObjectsWatcher;
+    managedObjectsWatcher = 0;
     delete defaultAdapterWatcher;
     defaultAdapterWatcher = 0;
     delete getPropertiesWatcher;
     getPropertiesWatcher = 0;
 }
 
-/// Try to establish the connection to BlueZ.
+/// Establishes the connection to BlueZ, or re-establishes it after
+/// BlueZ has been away. What we knew is kept: the signal connections
+/// stay in place and so do the device records. Only the adapter (and
+/// with BlueZ 4, its device list) is verified again; the states of
+/// devices we already know come from their signals.
 void BluezPlugin::connectToBluez()
 {
-    disconnectFromBluez();
     status = Connecting;
 
+    // When Bluez disappears from D-Bus, we emit failed to signal that we're
+    // not able to take in subscriptions. And when Bluez reappears, we emit
+    // "ready". Then the upper layer will renew its subscriptions (and we
+    // reconnect to bluez if needed).
+    if (!serviceWatcher) {
+        serviceWatcher = new QDBusServiceWatcher(serviceName, BLUEZ_PLUGIN_BUS);
+        sconnect(serviceWatcher, SIGNAL(serviceRegistered(const QString&)),
+                 this, SIGNAL(ready()), Qt::QueuedConnection);
+        sconnect(serviceWatcher, SIGNAL(serviceUnregistered(const QString&)), this, SLOT(emitFailed()));
+    }
+
+    if (manager) {
+        // We have talked to BlueZ 4 before
+        callDefaultAdapter();
+        return;
+    }
+
+    // Listen before asking, so that no change gets lost in between. If it
+    // turns out to be BlueZ 4, these are dropped again.
+    if (!objectManagerSignals) {
+        objectManagerSignals = new DBusSignalDemux(BLUEZ_PLUGIN_BUS, serviceName, managerPath,
+                                                   objectManagerInterface, this);
+        objectManagerSignals->addRoute("InterfacesAdded", QString(), this, "onInterfacesAdded");
+        objectManagerSignals->addRoute("InterfacesRemoved", QString(), this, "onInterfacesRemoved");
+        objectManagerSignals->start();
+        propertiesSignals = new DBusSignalDemux(BLUEZ_PLUGIN_BUS, serviceName, QString(),
+                                                propertiesInterface, this);
+        propertiesSignals->addRoute("PropertiesChanged", QString(), this, "onPropertiesChanged");
+        propertiesSignals->start();
+    }
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(serviceName, managerPath,
+                                                      objectManagerInterface, "GetManagedObjects");
+    managedObjectsWatcher = new QDBusPendingCallWatcher(BLUEZ_PLUGIN_BUS.asyncCall(msg));
+    sconnect(managedObjectsWatcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+             this, SLOT(managedObjectsFinished(QDBusPendingCallWatcher*)));
+}
+
+/// Connects to the BlueZ 4 API: the default adapter of the Manager.
+void BluezPlugin::connectToBluez4()
+{
+    delete objectManagerSignals;
+    objectManagerSignals = 0;
+    delete propertiesSignals;
+    propertiesSignals = 0;
+
     // If this function is executed because Bluez has just appeared on D-Bus,
     // it might be too early for the default adaptor to exist. It might be
     // that the DefaultAdapter call fails. To tackle that, we don't treat that
@@ -121,68 +227,230 @@ void BluezPlugin::connectToBluez()
 
     BLUEZ_PLUGIN_BUS.connect(serviceName, managerPath, managerInterface, "DefaultAdapterChanged",
                           this, SLOT(onDefaultAdapterChanged(QDBusObjectPath)));
+
+    // The PropertyChanged signals of all devices, whichever object path
+    deviceSignals = new DBusSignalDemux(BLUEZ_PLUGIN_BUS, serviceName, QString(),
+                                        deviceInterface, this);
+    deviceSignals->addRoute("PropertyChanged", QString(), this, "onDevicePropertyChanged");
+    deviceSignals->start();
+
     manager = new AsyncDBusInterface(serviceName, managerPath, managerInterface, BLUEZ_PLUGIN_BUS, this);
+    callDefaultAdapter();
+}
 
+/// Initiates the async DefaultAdapter D-Bus call.
+void BluezPlugin::callDefaultAdapter()
+{
     defaultAdapterWatcher =
         new QDBusPendingCallWatcher(manager->asyncCall("DefaultAdapter"));
     sconnect(defaultAdapterWatcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
              this, SLOT(defaultAdapterFinished(QDBusPendingCallWatcher*)));
-
-    // When Bluez disappears from D-Bus, we emit failed to signal that we're
-    // not able to take in subscriptions. And when Bluez reappears, we emit
-    // "ready". Then the upper layer will renew its subscriptions (and we
-    // reconnect to bluez if needed).
-    serviceWatcher = new QDBusServiceWatcher(serviceName, BLUEZ_PLUGIN_BUS);
-    sconnect(serviceWatcher, SIGNAL(serviceRegistered(const QString&)),
-            this, SIGNAL(ready()), Qt::QueuedConnection);
-    sconnect(serviceWatcher, SIGNAL(serviceUnregistered(const QString&)), this, SLOT(emitFailed()));
 }
 
-void BluezPlugin::evalConnected() {
+/// Called when the GetManagedObjects D-Bus call (the BlueZ 5 probe)
+/// finishes.
+void BluezPlugin::managedObjectsFinished(QDBusPendingCallWatcher* pcw)
+{
+    if (managedObjectsWatcher == pcw)
+        managedObjectsWatcher = 0;
+    pcw->deleteLater();
 
-    propertyCache[ckit::is_connected] = false;
+    if (pcw->isError()) {
+        if (pcw->error().type() == QDBusError::ServiceUnknown)
+            Q_EMIT failed("Provider not present: bluez");
+        else
+            connectToBluez4();
+        return;
+    }
 
-    Q_FOREACH (BluezDevice* device, devicesList) {
-        if (device->isConnected()) {
-            propertyCache[ckit::is_connected] = true;
-            break;
-        }
+    QMap<QString, BluezInterfaces> objects;
+    const QDBusArgument arg = qvariant_cast<QDBusArgument>(pcw->reply().arguments().value(0));
+    arg.beginMap();
+    while (!arg.atEnd()) {
+        QDBusObjectPath path;
+        arg.beginMapEntry();
+        arg >> path;
+        objects.insert(path.path(), readInterfaces(arg));
+        arg.endMapEntry();
     }
+    arg.endMap();
+
+    // Reconcile with what we knew before BlueZ went away: our adapter or
+    // some of the devices may be gone.
+    if (!adapterPath.isEmpty() && !objects.value(adapterPath).contains(adapter1Interface))
+        removeAdapter();
+    Q_FOREACH (const QString& path, devicesList.keys()) {
+        if (!objects.value(path).contains(device1Interface))
+            onDeviceRemoved(QDBusObjectPath(path));
+    }
+
+    // An adapter sorts before its devices
+    QMap<QString, BluezInterfaces>::const_iterator it;
+    for (it = objects.constBegin(); it != objects.constEnd(); ++it)
+        addObject(it.key(), it.value());
 
-    Q_EMIT valueChanged(ckit::is_connected, propertyCache[ckit::is_connected]);
+    status = Connected;
+    finishPendingSubscriptions();
 }
 
-void BluezPlugin::onConnectionStateChanged(bool status)
+/// Takes a BlueZ 5 object into use: the first adapter becomes our
+/// adapter, and the devices of our adapter are counted. Objects we
+/// already know are updated.
+void BluezPlugin::addObject(const QString& path, const BluezInterfaces& interfaces)
 {
-    if (propertyCache[ckit::is_connected].toBool() && !status) {
-        evalConnected();
+    BluezInterfaces::const_iterator it = interfaces.constFind(adapter1Interface);
+    if (it != interfaces.constEnd() && (adapterPath.isEmpty() || adapterPath == path)) {
+        adapterPath = path;
+        Q_FOREACH (const QString& key, it->keys())
+            setAdapterProperty(key, it->value(key));
     }
 
-    if (!propertyCache[ckit::is_connected].toBool() && status) {
-        propertyCache[ckit::is_connected] = status;
-        Q_EMIT valueChanged(ckit::is_connected,
-                            propertyCache[ckit::is_connected]);
+    it = interfaces.constFind(device1Interface);
+    if (it != interfaces.constEnd() && !adapterPath.isEmpty()
+        && path.startsWith(adapterPath + "/")) {
+        BluezDevice& device = devicesList[path];
+        device.known = true;
+        setDeviceConnected(path, it->value("Connected").toBool());
     }
 }
 
-void BluezPlugin::onDeviceCreated(QDBusObjectPath devicePath)
+/// Connected to the BlueZ 5 ObjectManager signal InterfacesAdded.
+void BluezPlugin::onInterfacesAdded(const QDBusMessage& msg)
+{
+    QList<QVariant> args = msg.arguments();
+    addObject(qdbus_cast<QDBusObjectPath>(args.value(0)).path(),
+              readInterfaces(args.value(1).value<QDBusArgument>()));
+}
+
+/// Connected to the BlueZ 5 ObjectManager signal InterfacesRemoved.
+void BluezPlugin::onInterfacesRemoved(const QDBusMessage& msg)
+{
+    QList<QVariant> args = msg.arguments();
+    QString path = qdbus_cast<QDBusObjectPath>(args.value(0)).path();
+    QStringList interfaces = args.value(1).toStringList();
+
+    if (interfaces.contains(device1Interface))
+        onDeviceRemoved(QDBusObjectPath(path));
+
+    if (interfaces.contains(adapter1Interface) && path == adapterPath)
+        removeAdapter();
+}
+
+/// Our BlueZ 5 adapter is gone; it's neither enabled nor visible, and
+/// its devices are gone with it. Another one is taken into use when it
+/// appears.
+void BluezPlugin::removeAdapter()
 {
-    if (!devicesList.contains(devicePath)) {
-        devicesList[devicePath] = new BluezDevice(devicePath.path());
-        sconnect(devicesList[devicePath], SIGNAL(connectionStateChanged(bool)),
-                 this,  SLOT(onConnectionStateChanged(bool)));
+    adapterPath.clear();
+    forgetDevices();
+    setAdapterProperty("Powered", false);
+    setAdapterProperty("Discoverable", false);
+}
+
+/// Drops all device records; the connected ones count as disconnected.
+void BluezPlugin::forgetDevices()
+{
+    Q_FOREACH (const QString& path, devicesList.keys())
+        onDeviceRemoved(QDBusObjectPath(path));
+}
+
+/// Connected to the D-Bus signal PropertiesChanged from any BlueZ 5
+/// object; the object path and the interface tell which one.
+void BluezPlugin::onPropertiesChanged(const QDBusMessage& msg)
+{
+    QList<QVariant> args = msg.arguments();
+    QString interface = args.value(0).toString();
+    QVariantMap changed = qdbus_cast<QVariantMap>(args.value(1));
+
+    if (interface == adapter1Interface && msg.path() == adapterPath) {
+        Q_FOREACH (const QString& key, changed.keys())
+            setAdapterProperty(key, changed[key]);
+    }
+    else if (interface == device1Interface && changed.contains("Connected")) {
+        setDeviceConnected(msg.path(), changed["Connected"].toBool());
     }
 }
 
+/// Emits Bluetooth.Connected if connectedCount has crossed zero.
+void BluezPlugin::updateConnected()
+{
+    bool connected = (connectedCount > 0);
+    if (propertyCache[ckit::is_connected].toBool() == connected)
+        return;
+    propertyCache[ckit::is_connected] = connected;
+    Q_EMIT valueChanged(ckit::is_connected, connected);
+}
+
+/// Updates the connection state of the device at \a path and
+/// connectedCount, on real transitions only.
+void BluezPlugin::setDeviceConnected(const QString& path, bool connected)
+{
+    QMap<QString, BluezDevice>::iterator it = devicesList.find(path);
+    if (it == devicesList.end())
+        return;
+    it->known = true;
+    if (it->connected == connected)
+        return;
+    it->connected = connected;
+    connectedCount += connected ? 1 : -1;
+    updateConnected();
+}
+
+/// Connected to the D-Bus signal PropertyChanged from any Bluez
+/// device, through deviceSignals; the object path tells the device.
+void BluezPlugin::onDevicePropertyChanged(const QDBusMessage& msg)
+{
+    QList<QVariant> args = msg.arguments();
+    if (args.value(0).toString() == "Connected")
+        setDeviceConnected(msg.path(),
+                           qdbus_cast<QDBusVariant>(args.value(1)).variant().toBool());
+}
+
+/// Starts tracking the device at \a devicePath. Its connection state
+/// is fetched with GetProperties; when many devices are created at
+/// once, the calls go out back to back and their replies are
+/// collected in deviceGetPropertiesFinished.
+void BluezPlugin::onDeviceCreated(QDBusObjectPath devicePath)
+{
+    QString path = devicePath.path();
+    if (devicesList.contains(path))
+        return;
+    devicesList.insert(path, BluezDevice());
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(serviceName, path,
+                                                      deviceInterface, "GetProperties");
+    QDBusPendingCallWatcher* pcw =
+        new QDBusPendingCallWatcher(BLUEZ_PLUGIN_BUS.asyncCall(msg));
+    sconnect(pcw, SIGNAL(finished(QDBusPendingCallWatcher*)),
+             this, SLOT(deviceGetPropertiesFinished(QDBusPendingCallWatcher*)));
+    deviceCalls.insert(pcw, path);
+}
+
 void BluezPlugin::onDeviceRemoved(QDBusObjectPath devicePath)
 {
-    if (devicesList.contains(devicePath)) {
-        disconnect(devicesList[devicePath], SIGNAL(connectionStateChanged(bool)),
-                   this,  SLOT(onConnectionStateChanged(bool)));
+    QString path = devicePath.path();
+    setDeviceConnected(path, false);
+    devicesList.remove(path);
+}
 
-        delete devicesList[devicePath];
-        devicesList.remove(devicePath);
-    }
+/// Called when the GetProperties D-Bus call of a device is done.
+void BluezPlugin::deviceGetPropertiesFinished(QDBusPendingCallWatcher* pcw)
+{
+    QString path = deviceCalls.take(pcw);
+    pcw->deleteLater();
+
+    QDBusPendingReply<QMap<QString, QVariant> > reply = *pcw;
+    if (reply.isError())
+        return;
+
+    // A PropertyChanged which came meanwhile is newer than this reply
+    QMap<QString, BluezDevice>::const_iterator it = devicesList.constFind(path);
+    if (it == devicesList.constEnd() || it->known)
+        return;
+
+    QMap<QString, QVariant> map = reply.argumentAt<0>();
+    if (map.contains("Connected"))
+        setDeviceConnected(path, map["Connected"].toBool());
 }
 
 /// Initates the async GetProperties D-Bus call.  Overwrites
@@ -220,24 +488,12 @@ void BluezPlugin::defaultAdapterFinished(QDBusPendingCallWatcher* pcw)
         }
     }
     else {
-            adapterPath = reply.argumentAt<0>().path();
-            adapter = new AsyncDBusInterface(serviceName, adapterPath,
-                                             adapterInterface, BLUEZ_PLUGIN_BUS,
-                                             this);
-
-            BLUEZ_PLUGIN_BUS.connect(serviceName, adapterPath,
-                          adapterInterface, "PropertyChanged",
-                          this, SLOT(onPropertyChanged(QString, QDBusVariant)));
-
-            BLUEZ_PLUGIN_BUS.connect(serviceName, adapterPath,
-                          adapterInterface, "DeviceCreated",
-                          this, SLOT(onDeviceCreated(QDBusObjectPath)));
-
-            BLUEZ_PLUGIN_BUS.connect(serviceName, adapterPath,
-                          adapterInterface, "DeviceRemoved",
-                          this, SLOT(onDeviceRemoved(QDBusObjectPath)));
-
-            callGetProperties();
+        // If it's the adapter we already had, its signal connections and
+        // devices are still valid; only its properties are fetched again.
+        QString path = reply.argumentAt<0>().path();
+        if (!adapter || path != adapterPath)
+            useAdapter(path);
+        callGetProperties();
     }
 
     if (defaultAdapterWatcher == pcw) {
@@ -249,26 +505,45 @@ void BluezPlugin::defaultAdapterFinished(QDBusPendingCallWatcher* pcw)
 /// Called when the GetProperties D-Bus call is done.
 void BluezPlugin::getPropertiesFinished(QDBusPendingCallWatcher* pcw)
 {
+    if (status == NotConnected) {
+        // An older call which was still in flight when Bluez went away
+        pcw->deleteLater();
+        return;
+    }
     status = Connected;
     QDBusPendingReply<QMap<QString, QVariant> > reply = *pcw;
     QMap<QString, QVariant> map = reply.argumentAt<0>();
     Q_FOREACH (const QString& key, map.keys()) {
-        if (properties.contains(key)) {
-            propertyCache[properties[key]] = map[key];
-            Q_EMIT valueChanged(properties[key], map[key]);
-            // Note: the upper layer is responsible for checking if the
-            // value was a different one.
-        }
+        setAdapterProperty(key, map[key]);
 
         if (key == "Devices") {
             QList<QDBusObjectPath> devicePaths = qdbus_cast<QList<QDBusObjectPath> >(map[key]);
-            Q_FOREACH(const QDBusObjectPath& path, devicePaths)
+            // Only the devices we don't know yet are fetched; their
+            // connection states come as transitions when known.
+            QSet<QString> current;
+            Q_FOREACH(const QDBusObjectPath& path, devicePaths) {
+                current << path.path();
                 onDeviceCreated(path);
-
-            evalConnected();
+            }
+            Q_FOREACH (const QString& path, devicesList.keys()) {
+                if (!current.contains(path))
+                    onDeviceRemoved(QDBusObjectPath(path));
+            }
         }
     }
 
+    finishPendingSubscriptions();
+
+    if (getPropertiesWatcher == pcw) {
+        getPropertiesWatcher = 0;
+    }
+    pcw->deleteLater();
+}
+
+/// Emits subscribeFinished (or subscribeFailed) for the keys which were
+/// waiting for the connection to Bluez.
+void BluezPlugin::finishPendingSubscriptions()
+{
     Q_FOREACH (const QString& key, pendingSubscriptions) {
         if (propertyCache.contains(key))
             Q_EMIT subscribeFinished(key, propertyCache[key]);
@@ -276,18 +551,41 @@ void BluezPlugin::getPropertiesFinished(QDBusPendingCallWatcher* pcw)
             Q_EMIT subscribeFailed(key, "Unknown key");
     }
     pendingSubscriptions.clear();
-
-    if (getPropertiesWatcher == pcw) {
-        getPropertiesWatcher = 0;
-    }
-    pcw->deleteLater();
 }
 
 /// Called when Bluez changes its default adapter.
 void BluezPlugin::onDefaultAdapterChanged(QDBusObjectPath path)
 {
-    adapterPath = path.path();
-    delete adapter;
+    useAdapter(path.path());
+
+    // It is possible that a previous GetProperties call is still ongoing.  Here
+    // we start another one, and overwrite getPropertiesWatcher.  The
+    // QDBusPendingCallWatcher of the old call will be deleted when the call
+    // finishes.
+    callGetProperties();
+}
+
+/// Switches to the BlueZ 4 adapter at \a path. The devices of the
+/// previous adapter, if any, are forgotten.
+void BluezPlugin::useAdapter(const QString& path)
+{
+    if (adapter) {
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                                 adapterInterface, "PropertyChanged",
+                                 this, SLOT(onPropertyChanged(QString, QDBusVariant)));
+
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                              adapterInterface, "DeviceCreated",
+                              this, SLOT(onDeviceCreated(QDBusObjectPath)));
+
+        BLUEZ_PLUGIN_BUS.disconnect(serviceName, adapterPath,
+                              adapterInterface, "DeviceRemoved",
+                              this, SLOT(onDeviceRemoved(QDBusObjectPath)));
+        delete adapter;
+    }
+    forgetDevices();
+
+    adapterPath = path;
     adapter = new AsyncDBusInterface(serviceName, adapterPath, adapterInterface, BLUEZ_PLUGIN_BUS, this);
     BLUEZ_PLUGIN_BUS.connect(serviceName, adapterPath,
                           adapterInterface, "PropertyChanged",
@@ -300,22 +598,25 @@ void BluezPlugin::onDefaultAdapterChanged(QDBusObjectPath path)
     BLUEZ_PLUGIN_BUS.connect(serviceName, adapterPath,
                           adapterInterface, "DeviceRemoved",
                           this, SLOT(onDeviceRemoved(QDBusObjectPath)));
-
-    // It is possible that a previous GetProperties call is still ongoing.  Here
-    // we start another one, and overwrite getPropertiesWatcher.  The
-    // QDBusPendingCallWatcher of the old call will be deleted when the call
-    // finishes.
-    callGetProperties();
 }
 
 /// Connected to the D-Bus signal PropertyChanged from BlueZ /
 /// adaptor. Check if the change is relevant, and if so, signal the
 /// value change of the corresponding context property.
 void BluezPlugin::onPropertyChanged(QString key, QDBusVariant value)
+{
+    setAdapterProperty(key, value.variant());
+}
+
+/// Updates the context property corresponding to the Bluez adapter
+/// property \a key, if any.
+void BluezPlugin::setAdapterProperty(const QString& key, const QVariant& value)
 {
     if (properties.contains(key)) {
-        propertyCache[properties[key]] = value.variant();
-        Q_EMIT valueChanged(properties[key], value.variant());
+        propertyCache[properties[key]] = value;
+        Q_EMIT valueChanged(properties[key], value);
+        // Note: the upper layer is responsible for checking if the
+        // value was a different one.
     }
 }
 
@@ -323,6 +624,9 @@ void BluezPlugin::onPropertyChanged(QString key, QDBusVariant value)
 /// bluez, no extra work is needed. Otherwise, initiate connecting to bluez.
 void BluezPlugin::subscribe(QSet<QString> keys)
 {
+    // A lingering connection is still up to date, just keep using it
+    lingerTimer.stop();
+
     if (status == Connected) {
         // we're already connected to bluez; so we know values for all the keys
         Q_FOREACH (const QString& key, keys) {
@@ -345,15 +649,16 @@ void BluezPlugin::subscribe(QSet<QString> keys)
     }
 }
 
-/// Implementation of the IPropertyProvider::unsubscribe. If none of the
-/// properties is needed, disconnect from bluez. The next subscriptions will
-/// make us connect again.
+/// Implementation of the IPropertyProvider::unsubscribe. When none of
+/// the properties is needed, we stay connected to bluez for
+/// lingerTimeout more, so that quick resubscriptions are answered from
+/// propertyCache without any D-Bus traffic.
 void BluezPlugin::unsubscribe(QSet<QString> keys)
 {
     wantedSubscriptions.subtract(keys);
-    if (wantedSubscriptions.isEmpty()) {
-        disconnectFromBluez();
-    }
+    pendingSubscriptions.subtract(keys);
+    if (wantedSubscriptions.isEmpty())
+        lingerTimer.start();
 }
 
 void BluezPlugin::blockUntilReady()
@@ -364,16 +669,44 @@ void BluezPlugin::blockUntilReady()
 
 void BluezPlugin::blockUntilSubscribed(const QString&)
 {
+    // The BlueZ 4 calls are started only when the probe has finished
+    if (managedObjectsWatcher)
+        managedObjectsWatcher->waitForFinished();
     if (defaultAdapterWatcher)
         defaultAdapterWatcher->waitForFinished();
     if (getPropertiesWatcher)
         getPropertiesWatcher->waitForFinished();
 }
 
-/// For emitting the failed() signal in a delayed way.
+/// For emitting the failed() signal in a delayed way. Called when Bluez
+/// disappears from D-Bus.
 void BluezPlugin::emitFailed(QString reason)
 {
     status = NotConnected;
+
+    // The calls in flight won't bring anything useful anymore
+    delete managedObjectsWatcher;
+    managedObjectsWatcher = 0;
+    delete defaultAdapterWatcher;
+    defaultAdapterWatcher = 0;
+    delete getPropertiesWatcher;
+    getPropertiesWatcher = 0;
+    qDeleteAll(deviceCalls.keys());
+    deviceCalls.clear();
+
+    // Bluez took the device connections with it. The records are kept
+    // for reconciling when it's back, except the ones whose state never
+    // arrived: those are fetched again then.
+    QMap<QString, BluezDevice>::iterator it = devicesList.begin();
+    while (it != devicesList.end()) {
+        if (!it->known) {
+            it = devicesList.erase(it);
+            continue;
+        }
+        setDeviceConnected(it.key(), false);
+        ++it;
+    }
+
     Q_EMIT failed(reason);
 }
 
@@ -30,10 +30,15 @@
 #include <QDBusInterface>
 #include <QSet>
 #include <QMap>
+#include <QHash>
 #include <QString>
+#include <QVariantMap>
+#include <QTimer>
 
 class QDBusServiceWatcher;
 class QDBusPendingCallWatcher;
+class QDBusMessage;
+class DBusSignalDemux;
 
 using ContextSubscriber::IProviderPlugin;
 
@@ -50,8 +55,10 @@ namespace ContextSubscriberBluez
   \class BluezPlugin
 
   \brief A libcontextsubscriber plugin for communicating with Bluez
-  over D-Bus. Provides context properties Bluetooth.Enabled and
-  Bluetooth.Visible.
+  over D-Bus. Provides context properties Bluetooth.Enabled,
+  Bluetooth.Visible and Bluetooth.Connected.
+
+  Speaks BlueZ 5 (ObjectManager) if available, and BlueZ 4 otherwise.
 
  */
 
@@ -68,19 +75,33 @@ public:
 
 private Q_SLOTS:
     void onPropertyChanged(QString key, QDBusVariant value);
-    void onConnectionStateChanged(bool status);
+    void onDevicePropertyChanged(const QDBusMessage& msg);
+    void deviceGetPropertiesFinished(QDBusPendingCallWatcher* pcw);
     void onDefaultAdapterChanged(QDBusObjectPath path);
     void emitFailed(QString reason = QString("Provider not present: bluez"));
     void onDeviceRemoved(QDBusObjectPath path);
     void onDeviceCreated(QDBusObjectPath path);
     void defaultAdapterFinished(QDBusPendingCallWatcher* pcw);
     void getPropertiesFinished(QDBusPendingCallWatcher* pcw);
+    void managedObjectsFinished(QDBusPendingCallWatcher* pcw);
+    void onInterfacesAdded(const QDBusMessage& msg);
+    void onInterfacesRemoved(const QDBusMessage& msg);
+    void onPropertiesChanged(const QDBusMessage& msg);
+    void disconnectFromBluez();
 
 private:
     void connectToBluez();
-    void disconnectFromBluez();
+    void connectToBluez4();
+    void addObject(const QString& path, const QMap<QString, QVariantMap>& interfaces);
+    void removeAdapter();
+    void useAdapter(const QString& path);
+    void forgetDevices();
+    void setAdapterProperty(const QString& key, const QVariant& value);
+    void finishPendingSubscriptions();
+    void callDefaultAdapter();
     void callGetProperties();
-    void evalConnected();
+    void updateConnected();
+    void setDeviceConnected(const QString& path, bool connected);
     AsyncDBusInterface* manager; ///< Bluez Manager interface
     AsyncDBusInterface* adapter; ///< Bluez Adapter interface
     QString adapterPath; ///< Object path of the Bluez adapter
@@ -89,6 +110,10 @@ private:
     static const QString managerInterface; ///< Interface name of Bluez manager
     static const QString adapterInterface; ///< Interface name of Bluez adapter
     static const QString deviceInterface; ///< Interface name of Bluez device
+    static const QString adapter1Interface; ///< Interface name of BlueZ 5 adapter
+    static const QString device1Interface; ///< Interface name of BlueZ 5 device
+    static const QString objectManagerInterface; ///< D-Bus ObjectManager interface name
+    static const QString propertiesInterface; ///< D-Bus Properties interface name
 
     enum ConnectionStatus {NotConnected, Connecting, Connected};
     ConnectionStatus status; ///< Whether we're currently connected to Bluez
@@ -96,11 +121,21 @@ private:
     QDBusPendingCallWatcher* defaultAdapterWatcher; ///< For watching the DefaultAdatpter D-Bus call
     QDBusPendingCallWatcher* getPropertiesWatcher; ///< For watching the DefaultAdatpter D-Bus call
 
-    QMap<QDBusObjectPath, BluezDevice*> devicesList;
+    QMap<QString, BluezDevice> devicesList; ///< Devices of the adapter by object path
+    int connectedCount; ///< How many of devicesList are connected
+    DBusSignalDemux* deviceSignals; ///< One PropertyChanged match for all devices
+    QHash<QDBusPendingCallWatcher*, QString> deviceCalls; ///< Device GetProperties calls in flight
+
+    QDBusPendingCallWatcher* managedObjectsWatcher; ///< For watching the GetManagedObjects D-Bus call
+    DBusSignalDemux* objectManagerSignals; ///< BlueZ 5 InterfacesAdded and InterfacesRemoved
+    DBusSignalDemux* propertiesSignals; ///< BlueZ 5 PropertiesChanged of all objects
     QMap<QString, QString> properties; ///< Mapping of Bluez properties to Context FW properties
     QMap<QString, QVariant> propertyCache;
     QSet<QString> pendingSubscriptions; ///< Keys for which subscribeFinished/Failed hasn't been emitted
     QSet<QString> wantedSubscriptions; ///< What the upper layer wants us to be subscribed to
+
+    static const int lingerTimeout = 10000; ///< How long we stay connected after the last unsubscribe
+    QTimer lingerTimer; ///< For disconnecting when nobody has been subscribed for lingerTimeout
 };
 }
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "dbussignaldemux.h"
+#include "logging.h"
+
+#include <QMetaObject>
+
+/// The empty signal name makes the match rule, and QtDBus' own hook,
+/// cover every signal of \a interface.
+#define DEMUX_ALL_SIGNALS QString()
+
+DBusSignalDemux::DBusSignalDemux(const QDBusConnection& bus, const QString& service,
+                                 const QString& path, const QString& interface,
+                                 QObject* parent)
+    : QObject(parent), bus(bus), service(service), path(path),
+      interface(interface), started(false)
+{
+}
+
+DBusSignalDemux::~DBusSignalDemux()
+{
+    stop();
+}
+
+/// Adds the match rule; safe to call multiple times.
+bool DBusSignalDemux::start()
+{
+    if (started)
+        return true;
+    started = bus.connect(service, path, interface, DEMUX_ALL_SIGNALS,
+                          this, SLOT(dispatch(const QDBusMessage&)));
+    if (!started)
+        contextWarning() << "Cannot listen to signals of" << interface;
+    return started;
+}
+
+/// Removes the match rule. The routes are kept.
+void DBusSignalDemux::stop()
+{
+    if (!started)
+        return;
+    bus.disconnect(service, path, interface, DEMUX_ALL_SIGNALS,
+                   this, SLOT(dispatch(const QDBusMessage&)));
+    started = false;
+}
+
+bool DBusSignalDemux::isStarted() const
+{
+    return started;
+}
+
+/// Delivers \a member signals from \a objectPath (any path if empty) to
+/// \a method of \a receiver. Replaces an existing route of the same key.
+void DBusSignalDemux::addRoute(const QString& member, const QString& objectPath,
+                               QObject* receiver, const char* method)
+{
+    Route route;
+    route.receiver = receiver;
+    route.method = method;
+    routes.insert(RouteKey(member, objectPath), route);
+}
+
+void DBusSignalDemux::removeRoute(const QString& member, const QString& objectPath)
+{
+    routes.remove(RouteKey(member, objectPath));
+}
+
+void DBusSignalDemux::dispatch(const QDBusMessage& msg)
+{
+    QHash<RouteKey, Route>::const_iterator it =
+        routes.constFind(RouteKey(msg.member(), msg.path()));
+    if (it == routes.constEnd())
+        it = routes.constFind(RouteKey(msg.member(), QString()));
+    if (it == routes.constEnd() || !it->receiver)
+        return;
+
+    QMetaObject::invokeMethod(it->receiver, it->method.constData(),
+                              Qt::DirectConnection, Q_ARG(QDBusMessage, msg));
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef DBUSSIGNALDEMUX_H
+#define DBUSSIGNALDEMUX_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QPair>
+#include <QPointer>
+#include <QDBusConnection>
+#include <QDBusMessage>
+
+/*!
+  \class DBusSignalDemux
+
+  \brief Receives all signals of one D-Bus interface through a single
+  match rule and dispatches them in-process.
+
+  Adding and removing routes never talks to the bus daemon; only
+  start() and stop() add and remove the match rule. A route delivers
+  the signal \a member, emitted on \a objectPath (or on any path if it
+  is empty), by invoking \a method on the receiver with the
+  QDBusMessage as the only argument:
+
+  \code
+  demux.addRoute(MCE_DISPLAY_SIG, QString(), this, "onMceSignal");
+  ...
+  Q_INVOKABLE void onMceSignal(const QDBusMessage& msg);
+  \endcode
+
+  A route with an explicit path is preferred over a path-less one.
+ */
+class DBusSignalDemux : public QObject
+{
+    Q_OBJECT
+
+public:
+    DBusSignalDemux(const QDBusConnection& bus, const QString& service,
+                    const QString& path, const QString& interface,
+                    QObject* parent = 0);
+    virtual ~DBusSignalDemux();
+
+    bool start();
+    void stop();
+    bool isStarted() const;
+
+    void addRoute(const QString& member, const QString& objectPath,
+                  QObject* receiver, const char* method);
+    void removeRoute(const QString& member, const QString& objectPath);
+
+private Q_SLOTS:
+    void dispatch(const QDBusMessage& msg);
+
+private:
+    typedef QPair<QString, QString> RouteKey; ///< (member, path)
+    struct Route
+    {
+        QPointer<QObject> receiver;
+        QByteArray method;
+    };
+
+    QDBusConnection bus;
+    QString service;
+    QString path;
+    QString interface;
+    bool started;
+    QHash<RouteKey, Route> routes;
+};
+
+#endif
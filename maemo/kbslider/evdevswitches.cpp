@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "evdevswitches.h"
+#include "sconnect.h"
+
+#include "logging.h"
+
+#include <QSocketNotifier>
+
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <cor/udev.hpp>
+
+#ifndef SYN_DROPPED
+#define SYN_DROPPED 3
+#endif
+
+/// How many events are read with one read() call
+#define EVENT_BATCH 16
+
+namespace ContextSubscriberKbSlider {
+
+EvdevSwitches* EvdevSwitches::instance()
+{
+    // Never deleted: the plugins may be unloaded in any order
+    static EvdevSwitches* switches = new EvdevSwitches();
+    return switches;
+}
+
+EvdevSwitches::EvdevSwitches()
+{
+    for (int code = 0; code <= SW_MAX; ++code)
+        users[code] = 0;
+}
+
+/// Starts using the switch \a code; the devices reporting it are opened
+/// by its first user.
+void EvdevSwitches::acquire(int code)
+{
+    if (code < 0 || code > SW_MAX)
+        return;
+    if (users[code]++ == 0) {
+        wanted.set(code);
+        openInputs(code);
+    }
+}
+
+/// Stops using the switch \a code. The devices which report no acquired
+/// switch anymore are closed once control returns to the event loop,
+/// as this can be called from a switchChanged() handler.
+void EvdevSwitches::release(int code)
+{
+    if (code < 0 || code > SW_MAX || users[code] == 0)
+        return;
+    if (--users[code] == 0) {
+        wanted.reset(code);
+        QMetaObject::invokeMethod(this, "closeUnused", Qt::QueuedConnection);
+    }
+}
+
+/// Whether some of the opened devices reports the switch \a code.
+bool EvdevSwitches::has(int code) const
+{
+    Q_FOREACH (const Input& input, inputs) {
+        if (input.caps.test(code))
+            return true;
+    }
+    return false;
+}
+
+/// The current state of the switch \a code: on if it is on in any device
+/// reporting it; false if there is no such switch.
+bool EvdevSwitches::value(int code) const
+{
+    Q_FOREACH (const Input& input, inputs) {
+        if (input.caps.test(code) && input.state.test(code))
+            return true;
+    }
+    return false;
+}
+
+/// Opens the event nodes of the input devices which report the switch
+/// \a code, unless already open.
+void EvdevSwitches::openInputs(int code)
+{
+    using namespace cor::udev;
+    Root udev;
+    if (!udev)
+        return;
+
+    Enumerate input(udev);
+    if (!input)
+        return;
+
+    // The capabilities are attributes of the input device, the node to
+    // open belongs to its event device.
+    input.subsystem_add("input");
+    input.sysname_add("event*");
+
+    auto open_input = [this, &udev, code](ListEntry const &e) -> bool {
+        Device event(udev, e.path());
+        cor::evdev::SwitchBits caps;
+        if (caps.parse(event.parent_with_subsystem("input").attr("capabilities/sw"))
+            && caps.test(code) && event.devnode())
+            openInput(event.devnode(), caps);
+        return true;
+    };
+    input.devices().for_each(open_input);
+}
+
+void EvdevSwitches::openInput(const char* devnode, const cor::evdev::SwitchBits& caps)
+{
+    Q_FOREACH (const Input& input, inputs) {
+        if (input.devnode == devnode)
+            return; // opened for another switch already
+    }
+
+    int fd = open(devnode, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        contextWarning() << "Cannot open" << devnode;
+        return;
+    }
+    contextDebug() << "Reading switches from" << devnode;
+
+    Input input;
+    input.devnode = devnode;
+    input.fd = fd;
+    input.caps = caps;
+    input.dropped = false;
+    input.gone = false;
+    input.notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    sconnect(input.notifier, SIGNAL(activated(int)), this, SLOT(onEvent(int)));
+    inputs.append(input);
+
+    readState(inputs.last(), false);
+}
+
+/// Closes the devices which are gone or none of whose switches is
+/// acquired, and emits switchChanged for the acquired switches whose
+/// combined state changes with them.
+void EvdevSwitches::closeUnused()
+{
+    cor::evdev::SwitchBits affected, before;
+    Q_FOREACH (const Input& input, inputs) {
+        if (!input.gone)
+            continue;
+        for (int code = 0; code <= SW_MAX; ++code) {
+            if (!input.caps.test(code) || !wanted.test(code))
+                continue;
+            affected.set(code);
+            if (value(code))
+                before.set(code);
+        }
+    }
+
+    QList<Input>::iterator it = inputs.begin();
+    while (it != inputs.end()) {
+        if (!it->gone && it->caps.intersects(wanted)) {
+            ++it;
+            continue;
+        }
+        contextDebug() << "Closing" << it->devnode;
+        closeInput(*it);
+        it = inputs.erase(it);
+    }
+
+    for (int code = 0; code <= SW_MAX; ++code) {
+        if (affected.test(code) && value(code) != before.test(code))
+            Q_EMIT switchChanged(code, !before.test(code));
+    }
+}
+
+void EvdevSwitches::closeInput(const Input& input)
+{
+    delete input.notifier;
+    close(input.fd);
+}
+
+/// Reads the states of the switches of \a input from the kernel. The
+/// initial states are taken silently; the users read them with value().
+void EvdevSwitches::readState(Input& input, bool notify)
+{
+    cor::evdev::SwitchBits bits;
+    if (ioctl(input.fd, EVIOCGSW(bits.size()), bits.data()) < 0)
+        return;
+
+    for (int code = 0; code <= SW_MAX; ++code) {
+        if (!input.caps.test(code))
+            continue;
+        if (notify)
+            setSwitch(input, code, bits.test(code));
+        else if (bits.test(code))
+            input.state.set(code);
+        else
+            input.state.reset(code);
+    }
+}
+
+/// Reads all the pending events of the device, a batch at a time.
+void EvdevSwitches::onEvent(int fd)
+{
+    QList<Input>::iterator it = inputs.begin();
+    while (it != inputs.end() && it->fd != fd)
+        ++it;
+    if (it == inputs.end())
+        return;
+    // QList keeps large items in place, so this stays valid even if a
+    // switchChanged() handler opens more devices
+    Input& input = *it;
+
+    struct input_event events[EVENT_BATCH];
+    while (true) {
+        ssize_t rd = read(fd, events, sizeof(events));
+        if (rd < 0 && errno == EINTR)
+            continue;
+        if (rd < (ssize_t)sizeof(struct input_event)) {
+            if (rd == 0 || (rd < 0 && errno != EAGAIN)) {
+                // The device is gone; stop polling it, and close it
+                // once we are out of the notifier's signal
+                contextWarning() << "Cannot read switch events from" << input.devnode;
+                input.notifier->setEnabled(false);
+                input.gone = true;
+                QMetaObject::invokeMethod(this, "closeUnused", Qt::QueuedConnection);
+            }
+            break;
+        }
+
+        size_t count = rd / sizeof(struct input_event);
+        for (size_t i = 0; i < count; ++i)
+            handleEvent(input, events[i]);
+
+        if (count < EVENT_BATCH)
+            break; // the queue is empty
+    }
+}
+
+/// Collects the switch changes of a frame, and applies them when the
+/// frame is complete.
+void EvdevSwitches::handleEvent(Input& input, const struct input_event& event)
+{
+    if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+        // The event queue overflowed; the frame is incomplete, and so
+        // is everything until the next SYN_REPORT.
+        input.dropped = true;
+        input.frameChanged.clear();
+    }
+    else if (event.type == EV_SYN && event.code == SYN_REPORT) {
+        if (input.dropped) {
+            input.dropped = false;
+            readState(input, true);
+        }
+        else if (input.frameChanged.any()) {
+            for (int code = 0; code <= SW_MAX; ++code) {
+                if (input.frameChanged.test(code))
+                    setSwitch(input, code, input.frameValues.test(code));
+            }
+        }
+        input.frameChanged.clear();
+    }
+    else if (!input.dropped && event.type == EV_SW) {
+        input.frameChanged.set(event.code);
+        if (event.value)
+            input.frameValues.set(event.code);
+        else
+            input.frameValues.reset(event.code);
+    }
+}
+
+/// Records the state \a on of the switch \a code of \a input, and emits
+/// switchChanged if the combined state changes.
+void EvdevSwitches::setSwitch(Input& input, int code, bool on)
+{
+    if (!input.caps.test(code) || input.state.test(code) == on)
+        return;
+    bool before = value(code);
+    if (on)
+        input.state.set(code);
+    else
+        input.state.reset(code);
+    if (value(code) != before)
+        Q_EMIT switchChanged(code, !before);
+}
+
+} // end namespace
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef EVDEVSWITCHES_H
+#define EVDEVSWITCHES_H
+
+#include <cor/evdev.hpp>
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+
+class QSocketNotifier;
+
+namespace ContextSubscriberKbSlider
+{
+
+/*!
+  \class EvdevSwitches
+
+  \brief The states of the EV_SW switches of the input devices, shared
+  by the plugin instances of the process.
+
+  Users acquire() the switches they need, one code at a time. Only the
+  devices reporting some acquired switch are opened (found through
+  udev, each opened once), and a device is closed when none of its
+  switches is acquired anymore. The initial states are read with
+  EVIOCGSW; after that they are only updated from the events, which
+  are read in batches and applied a SYN_REPORT frame at a time.
+
+  Each device keeps its own states. If several devices report the same
+  switch, the switch is on when it is on in any of them. switchChanged()
+  is emitted only when this combined state really changes, also when
+  it changes because a device went away.
+ */
+class EvdevSwitches : public QObject
+{
+    Q_OBJECT
+
+public:
+    static EvdevSwitches* instance();
+
+    void acquire(int code);
+    void release(int code);
+
+    bool has(int code) const;
+    bool value(int code) const;
+
+Q_SIGNALS:
+    void switchChanged(int code, bool on);
+
+private Q_SLOTS:
+    void onEvent(int fd);
+    void closeUnused();
+
+private:
+    /// One opened input device
+    struct Input
+    {
+        QByteArray devnode;
+        int fd;
+        QSocketNotifier* notifier;
+        cor::evdev::SwitchBits caps; ///< Switches the device reports
+        cor::evdev::SwitchBits state; ///< Their current states
+        cor::evdev::SwitchBits frameChanged; ///< Switches set in the current frame
+        cor::evdev::SwitchBits frameValues; ///< ... and their values
+        bool dropped; ///< The kernel dropped events, skip until SYN_REPORT
+        bool gone; ///< The device cannot be read anymore, close it
+    };
+
+    EvdevSwitches();
+    void openInputs(int code);
+    void openInput(const char* devnode, const cor::evdev::SwitchBits& caps);
+    void closeInput(const Input& input);
+    void readState(Input& input, bool notify);
+    void handleEvent(Input& input, const struct input_event& event);
+    void setSwitch(Input& input, int code, bool on);
+
+    int users[SW_MAX + 1]; ///< How many have acquired each switch
+    cor::evdev::SwitchBits wanted; ///< The switches acquired by somebody
+    QList<Input> inputs;
+};
+
+}
+
+#endif
@@ -20,46 +20,41 @@
  */
 
 #include "kbsliderplugin.h"
+#include "switchplugin.h"
+#include "evdevswitches.h"
 #include "sconnect.h"
 
 #include "logging.h"
 
 #include <QFile>
-#include <QSocketNotifier>
 
 #include <linux/input.h>
-#include <stdio.h>
-#include <fcntl.h>
-
-extern "C" {
-#include <libudev.h>
-}
 
 #include <contextkit_props/internal_keyboard.hpp>
-
-#define GPIO_FILE "/dev/input/gpio-keys"
+#include <cor/evdev.hpp>
+#include <cor/udev.hpp>
 
 namespace ckit = contextkit::internal_keyboard;
 
 static const QString KeypadFile("/dev/input/keypad");
 
 /// The factory method for constructing the IPropertyProvider instance.
-IProviderPlugin* pluginFactory(const QString& /*constructionString*/)
+/// The construction string is the interface name from the context file.
+IProviderPlugin* pluginFactory(const QString& constructionString)
 {
+    if (constructionString == "switches")
+        return new ContextSubscriberKbSlider::SwitchPlugin();
     return new ContextSubscriberKbSlider::KbSliderPlugin();
 }
 
 namespace ContextSubscriberKbSlider {
 
-#define BITS_PER_LONG (sizeof(long) * 8)
-#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
-#define LONG(x) ((x)/BITS_PER_LONG)
-#define OFF(x)  ((x)%BITS_PER_LONG)
-#define test_bit(bit, array)    ((array[LONG(bit)] >> OFF(bit)) & 1)
-
 KbSliderPlugin::KbSliderPlugin():
-    sn(0), eventFd(-1)
+    kbPresentRead(false),
+    watchingSlider(false)
 {
+    sconnect(EvdevSwitches::instance(), SIGNAL(switchChanged(int, bool)),
+             this, SLOT(onSwitchChanged(int, bool)));
     QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
@@ -79,70 +74,31 @@ QString KbSliderPlugin::findKeypadDevice()
 /// events, sets kbPresent to true, otherwise, to false.
 void KbSliderPlugin::readKbPresent()
 {
-    static bool read = false;
-    if (read)
+    if (kbPresentRead)
         return;
-    read = true;
+    kbPresentRead = true;
 
-    struct udev* udev = udev_new();
-    if (udev == NULL) {
+    cor::udev::Root udev;
+    if (!udev)
         return;
-    }
 
     QString sysPath = QString("/sys/%1")
         .arg(findKeypadDevice());
 
-    struct udev_device* originalDev = udev_device_new_from_syspath(udev,
-                                                           sysPath.toAscii().constData());
-    struct udev_device* dev = originalDev;
-
-    const char* capabilities = 0;
-    QStringList split;
-    unsigned long lowBits[1] = {0};
-    bool ok = false;
-
-    if (dev == NULL) {
-        goto out_udev;
-    }
+    cor::udev::Device dev(udev, sysPath.toAscii().constData());
 
     // Walk to the parent until we get a device with "capabilities/key". E.g.,
     // this device is /devices/platform/something/input/inputX/eventX but we
     // need to go to the parent /devices/platform/something/input/inputX
-    while (dev != NULL && udev_device_get_sysattr_value(dev, "capabilities/key") == NULL) {
-        dev = udev_device_get_parent_with_subsystem_devtype(dev, "input", NULL);
-        // We don't need to decrement the ref count, since the returned device
-        // is not referenced, and will be cleaned up when the child device is
-        // cleaned up.
-    }
+    while (dev && !dev.attr("capabilities/key"))
+        dev = dev.parent_with_subsystem("input");
 
     // We can assume that the input device in question has events of type
-    // KEY. The only thing to check is which key events are supported.
-
-    // Get the key bitmask. The returned string contains hexadecimal numbers
-    // separated by spaces. The actual key bitmask is these numbers in reverse
-    // order. We're only interested in the low bits, so we check only the last
-    // number.
-    capabilities = udev_device_get_sysattr_value(dev, "capabilities/key");
-    if (capabilities == 0)
-        goto out_device;
-
-    split = QString(capabilities).split(' ', QString::SkipEmptyParts);
-    if (split.isEmpty())
-        goto out_device;
-
-    lowBits[0] = split.last().toULong(&ok, 16);
-    if (!ok)
-        goto out_device;
-
-    // Check the bits KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T and KEY_Y.
-    kbPresent = test_bit(KEY_Q, lowBits) && test_bit(KEY_W, lowBits) &&
-        test_bit(KEY_E, lowBits) && test_bit(KEY_R, lowBits) &&
-        test_bit(KEY_T, lowBits) && test_bit(KEY_Y, lowBits);
-
-out_device:
-    udev_device_unref(originalDev);
-out_udev:
-    udev_unref(udev);
+    // KEY. The only thing to check is which key events are supported: the
+    // bits KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T and KEY_Y.
+    cor::evdev::KeyBits keys;
+    if (keys.parse(dev.attr("capabilities/key")))
+        kbPresent = keys.test_range(KEY_Q, KEY_Y);
 }
 
 /// Emits the subscribeFinished or subscribeFailed signal for ckit::is_present.
@@ -156,12 +112,17 @@ void KbSliderPlugin::emitFinishedKbPresent()
     }
 }
 
+/// Emits the subscribeFinished or subscribeFailed signal for ckit::is_open.
 void KbSliderPlugin::readSliderStatus()
 {
-    unsigned long bits[NBITS(KEY_MAX)] = {0};
-
-    if (ioctl(eventFd, EVIOCGSW(KEY_MAX), bits) > 0)
-        kbOpen = QVariant(test_bit(SW_KEYPAD_SLIDE, bits) == 0);
+    EvdevSwitches* switches = EvdevSwitches::instance();
+    if (!switches->has(SW_KEYPAD_SLIDE)) {
+        // No device reports the slider
+        unsubscribe(QSet<QString>() << ckit::is_open);
+        emit subscribeFailed(ckit::is_open, QString("Cannot read the keyboard slider"));
+        return;
+    }
+    kbOpen = QVariant(!switches->value(SW_KEYPAD_SLIDE));
 
     if (!kbPresent.isNull() && kbPresent == false) {
         // But if the keyboard is not present, it cannot be open. Also stop
@@ -174,16 +135,19 @@ void KbSliderPlugin::readSliderStatus()
     emit subscribeFinished(ckit::is_open);
 }
 
-void KbSliderPlugin::onSliderEvent()
+void KbSliderPlugin::onSwitchChanged(int code, bool on)
 {
-    // Something happened in the input file; read the events, decide whether
-    // they're interesting, and update the context properties.
-    struct input_event event;
-    size_t rd = read(eventFd, &event, sizeof(event));
-    if (rd == sizeof(event) && event.type == EV_SW && event.code == SW_KEYPAD_SLIDE) {
-        kbOpen = (event.value == 0);
-        emit valueChanged(ckit::is_open, kbOpen);
-    }
+    if (watchingSlider && code == SW_KEYPAD_SLIDE)
+        setKbOpen(!on);
+}
+
+/// Emits valueChanged for ckit::is_open if \a open is a new value.
+void KbSliderPlugin::setKbOpen(bool open)
+{
+    if (!kbOpen.isNull() && kbOpen.toBool() == open)
+        return;
+    kbOpen = open;
+    emit valueChanged(ckit::is_open, kbOpen);
 }
 
 /// Implementation of the IPropertyProvider::subscribe.
@@ -197,14 +161,11 @@ void KbSliderPlugin::subscribe(QSet<QString> keys)
         QMetaObject::invokeMethod(this, "emitFinishedKbPresent", Qt::QueuedConnection);
     }
     if (keys.contains(ckit::is_open)) {
-        // Start polling the event file
-        eventFd = open(GPIO_FILE, O_RDONLY);
-        if (eventFd < 0) {
-            emit subscribeFailed(ckit::is_open, "Cannot open " GPIO_FILE);
-            return;
+        // Start watching the slider switch
+        if (!watchingSlider) {
+            watchingSlider = true;
+            EvdevSwitches::instance()->acquire(SW_KEYPAD_SLIDE);
         }
-        sn = new QSocketNotifier(eventFd, QSocketNotifier::Read, this);
-        sconnect(sn, SIGNAL(activated(int)), this, SLOT(onSliderEvent()));
 
         // Read the initial status. This will also emit subscribeFinished /
         // subscribeFailed.
@@ -215,12 +176,10 @@ void KbSliderPlugin::subscribe(QSet<QString> keys)
 /// Implementation of the IPropertyProvider::unsubscribe.
 void KbSliderPlugin::unsubscribe(QSet<QString> keys)
 {
-    if (keys.contains(ckit::is_open)) {
+    if (keys.contains(ckit::is_open) && watchingSlider) {
         // stop the listening activities
-        delete sn;
-        sn = 0;
-        if (eventFd >= 0) close(eventFd);
-        eventFd = -1;
+        watchingSlider = false;
+        EvdevSwitches::instance()->release(SW_KEYPAD_SLIDE);
     }
 }
 
@@ -32,7 +32,6 @@ extern "C" {
     IProviderPlugin* pluginFactory(const QString& constructionString);
 }
 
-class QSocketNotifier;
 
 namespace ContextSubscriberKbSlider
 {
@@ -44,6 +43,8 @@ namespace ContextSubscriberKbSlider
   status. Provides context properties /maemo/InternalKeyboard/Present and
   /maemo/InternalKeyboard/Open.
 
+  The slider is the SW_KEYPAD_SLIDE switch, read through EvdevSwitches.
+
  */
 
 class KbSliderPlugin : public IProviderPlugin
@@ -58,17 +59,18 @@ public:
     virtual void blockUntilSubscribed(const QString& key);
 
 private Q_SLOTS:
-    void onSliderEvent();
+    void onSwitchChanged(int code, bool on);
     void readSliderStatus();
     void readKbPresent();
     void emitFinishedKbPresent();
 
 private:
     QString findKeypadDevice();
+    void setKbOpen(bool open);
     QVariant kbOpen; // current value of the "keyboard open" key
     QVariant kbPresent; // current value of the "keyboard present" key
-    QSocketNotifier* sn;
-    int eventFd;
+    bool kbPresentRead; // whether readKbPresent() has been done
+    bool watchingSlider; // whether we use the SW_KEYPAD_SLIDE switch
 };
 }
 
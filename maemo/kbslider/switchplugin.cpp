@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "switchplugin.h"
+#include "evdevswitches.h"
+#include "sconnect.h"
+
+#include <linux/input.h>
+
+#include <contextkit_props/switches.hpp>
+
+// Older kernel headers don't know all the switches
+#ifndef SW_DOCK
+#define SW_DOCK 0x05
+#endif
+#ifndef SW_LINEOUT_INSERT
+#define SW_LINEOUT_INSERT 0x06
+#endif
+#ifndef SW_JACK_PHYSICAL_INSERT
+#define SW_JACK_PHYSICAL_INSERT 0x07
+#endif
+#ifndef SW_VIDEOOUT_INSERT
+#define SW_VIDEOOUT_INSERT 0x08
+#endif
+#ifndef SW_CAMERA_LENS_COVER
+#define SW_CAMERA_LENS_COVER 0x09
+#endif
+#ifndef SW_FRONT_PROXIMITY
+#define SW_FRONT_PROXIMITY 0x0b
+#endif
+
+namespace ckit = contextkit::switches;
+
+namespace ContextSubscriberKbSlider {
+
+/// The context properties and the switches they are read from
+static const struct {
+    const char* key;
+    int code;
+} switchKeys[] = {
+    { ckit::is_lid_closed, SW_LID },
+    { ckit::is_tablet_mode, SW_TABLET_MODE },
+    { ckit::is_headphone_inserted, SW_HEADPHONE_INSERT },
+    { ckit::is_microphone_inserted, SW_MICROPHONE_INSERT },
+    { ckit::is_lineout_inserted, SW_LINEOUT_INSERT },
+    { ckit::is_jack_inserted, SW_JACK_PHYSICAL_INSERT },
+    { ckit::is_videoout_inserted, SW_VIDEOOUT_INSERT },
+    { ckit::is_docked, SW_DOCK },
+    { ckit::is_lens_covered, SW_CAMERA_LENS_COVER },
+    { ckit::is_front_proximity, SW_FRONT_PROXIMITY },
+};
+
+SwitchPlugin::SwitchPlugin()
+{
+    sconnect(EvdevSwitches::instance(), SIGNAL(switchChanged(int, bool)),
+             this, SLOT(onSwitchChanged(int, bool)));
+    QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
+}
+
+/// The switch of the context property \a key, -1 if there is none.
+int SwitchPlugin::codeOf(const QString& key)
+{
+    for (unsigned i = 0; i < sizeof(switchKeys) / sizeof(switchKeys[0]); ++i) {
+        if (key == switchKeys[i].key)
+            return switchKeys[i].code;
+    }
+    return -1;
+}
+
+/// Implementation of the IPropertyProvider::subscribe. The devices
+/// reporting the switch of a key are opened when it is subscribed; the
+/// value is known right after that.
+void SwitchPlugin::subscribe(QSet<QString> keys)
+{
+    EvdevSwitches* switches = EvdevSwitches::instance();
+
+    Q_FOREACH (const QString& key, keys) {
+        int code = codeOf(key);
+        if (code < 0) {
+            Q_EMIT subscribeFailed(key, "No such switch");
+            continue;
+        }
+        if (!subscribedKeys.contains(key)) {
+            switches->acquire(code);
+            if (!switches->has(code)) {
+                switches->release(code);
+                Q_EMIT subscribeFailed(key, "No such switch");
+                continue;
+            }
+            subscribedKeys << key;
+        }
+        Q_EMIT subscribeFinished(key, switches->value(code));
+    }
+}
+
+/// Implementation of the IPropertyProvider::unsubscribe. The devices
+/// are closed when none of their switches is needed anymore.
+void SwitchPlugin::unsubscribe(QSet<QString> keys)
+{
+    Q_FOREACH (const QString& key, keys) {
+        if (subscribedKeys.remove(key))
+            EvdevSwitches::instance()->release(codeOf(key));
+    }
+}
+
+void SwitchPlugin::onSwitchChanged(int code, bool on)
+{
+    Q_FOREACH (const QString& key, subscribedKeys) {
+        if (codeOf(key) == code)
+            Q_EMIT valueChanged(key, on);
+    }
+}
+
+void SwitchPlugin::blockUntilReady()
+{
+    // This plugin is immediately ready
+    Q_EMIT ready();
+}
+
+void SwitchPlugin::blockUntilSubscribed(const QString&)
+{
+    // The subscriptions are finished right away
+}
+
+} // end namespace
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef SWITCHPLUGIN_H
+#define SWITCHPLUGIN_H
+
+#include <iproviderplugin.h> // For IProviderPlugin definition
+#include <QSet>
+#include <QString>
+
+using ContextSubscriber::IProviderPlugin;
+
+namespace ContextSubscriberKbSlider
+{
+
+/*!
+  \class SwitchPlugin
+
+  \brief A libcontextsubscriber plugin for the evdev switches: lid,
+  headphone and other jacks, camera lens cover etc. Provides the
+  context properties of data/switches.list.
+
+  The switches are read through EvdevSwitches, which is shared with
+  KbSliderPlugin; keys whose switch no device reports fail to
+  subscribe.
+ */
+
+class SwitchPlugin : public IProviderPlugin
+{
+    Q_OBJECT
+
+public:
+    explicit SwitchPlugin();
+    virtual void subscribe(QSet<QString> keys);
+    virtual void unsubscribe(QSet<QString> keys);
+    virtual void blockUntilReady();
+    virtual void blockUntilSubscribed(const QString& key);
+
+private Q_SLOTS:
+    void onSwitchChanged(int code, bool on);
+
+private:
+    static int codeOf(const QString& key);
+    QSet<QString> subscribedKeys;
+};
+}
+
+#endif
@@ -22,6 +22,7 @@
 #include "mceplugin.h"
 #include "sconnect.h"
 #include "logging.h"
+#include "dbussignaldemux.h"
 // This is for getting rid of synchronous D-Bus introspection calls Qt does.
 #include <asyncdbusinterface.h>
 
@@ -33,6 +34,8 @@
 #include <QDBusPendingCallWatcher>
 #include <QDBusPendingCall>
 
+#include <stdlib.h>
+
 #include <contextkit_props/mce.hpp>
 
 /// The factory method for constructing the IPropertyProvider instance.
@@ -49,15 +52,66 @@ namespace ckit = contextkit::mce;
 
 #define MCE_PLUGIN_BUS QDBusConnection::systemBus()
 
-MCEPlugin::MCEPlugin() : mce(0), serviceWatcher(0), subscribeCount(0)
+/// Get-call and change signal of each MCEPlugin::Query, and the minimum
+/// time (ms) between two emissions for the noisy ones. The sensor and
+/// CPU mode interfaces are only in newer mce-dev versions; built against
+/// an older one, their keys fail to subscribe (the method is null).
+static const struct {
+    const char *method;
+    const char *signal;
+    int minInterval;
+} mceQueries[] = {
+    { MCE_DISPLAY_STATUS_GET, MCE_DISPLAY_SIG, 0 },
+    { MCE_PSM_STATE_GET, MCE_PSM_STATE_SIG, 0 },
+    { MCE_RADIO_STATES_GET, MCE_RADIO_STATES_SIG, 0 },
+#if defined(MCE_ALS_LUX_GET) && defined(MCE_ALS_LUX_SIG)
+    { MCE_ALS_LUX_GET, MCE_ALS_LUX_SIG, 1000 },
+#else
+    { 0, 0, 0 },
+#endif
+#if defined(MCE_PS_STATE_GET) && defined(MCE_PS_STATE_SIG) && defined(MCE_PS_COVERED)
+    { MCE_PS_STATE_GET, MCE_PS_STATE_SIG, 0 },
+#else
+    { 0, 0, 0 },
+#endif
+#if defined(MCE_CPU_MODE_GET) && defined(MCE_CPU_MODE_SIG)
+    { MCE_CPU_MODE_GET, MCE_CPU_MODE_SIG, 0 }
+#else
+    { 0, 0, 0 }
+#endif
+};
+
+/// Default for cacheWindow, overridable with CONTEXT_MCE_CACHE_WINDOW (ms)
+static const int defaultCacheWindow = 10000;
+
+MCEPlugin::MCEPlugin() : mce(0), serviceWatcher(0), mceSignals(0),
+                         cacheWindow(defaultCacheWindow)
 {
+    for (int i = 0; i < QueryCount; ++i) {
+        pendingQueries[i] = 0;
+        throttled[i] = false;
+    }
+    throttleTimer.setSingleShot(true);
+    sconnect(&throttleTimer, SIGNAL(timeout()), this, SLOT(emitThrottled()));
+    const char *window = getenv("CONTEXT_MCE_CACHE_WINDOW");
+    if (window)
+        cacheWindow = atoi(window);
+    lingerTimer.setSingleShot(true);
+    sconnect(&lingerTimer, SIGNAL(timeout()), this, SLOT(stopTracking()));
     // We're ready to take in subscriptions right away; we'll connect to MCE
     // when we get subscriptions.
     QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
+MCEPlugin::~MCEPlugin()
+{
+    disconnectFromMce();
+}
+
 void MCEPlugin::disconnectFromMce()
 {
+    delete mceSignals;
+    mceSignals = 0;
     delete mce;
     mce = 0;
     delete serviceWatcher;
@@ -79,254 +133,296 @@ void MCEPlugin::connectToMce()
             this, SIGNAL(ready()), Qt::QueuedConnection);
     connect(serviceWatcher, SIGNAL(serviceUnregistered(const QString&)),
             this, SLOT(emitFailed()));
+
+    // One match rule for all MCE signals, installed while something is
+    // subscribed and for cacheWindow after that: (un)subscribing keys
+    // meanwhile never touches the bus daemon.
+    mceSignals = new DBusSignalDemux(MCE_PLUGIN_BUS, MCE_SERVICE, MCE_SIGNAL_PATH,
+                                     MCE_SIGNAL_IF, this);
+    for (int query = 0; query < QueryCount; ++query)
+        if (mceQueries[query].signal)
+            mceSignals->addRoute(mceQueries[query].signal, QString(), this, "onMceSignal");
 }
 
-/// Callback for "get display status"
-void MCEPlugin::getDisplayStatusFinished(QDBusPendingCallWatcher* pcw)
+/// Once nothing is subscribed, keeps the signal match (and so the
+/// cache current) for cacheWindow: a key resubscribed meanwhile, e.g.
+/// by an application coming back to the foreground, is answered from
+/// the cache without asking MCE.
+void MCEPlugin::lingerIfIdle()
 {
-    QDBusPendingReply<QString> reply = *pcw;
-    if (reply.isError()) {
-        if (reply.error().type() == QDBusError::ServiceUnknown) {
-            // We need to fail explicitly so that we can emit ready() when the
-            // provider is started. (We have already emitted ready(), and
-            // emitting ready() 2 times has no effect.)
-            Q_EMIT failed("Provider not present: mce");
-        }
-        else
-            Q_EMIT subscribeFailed(ckit::is_screen_blanked, reply.error().message());
-    }
-    else {
-        bool blanked = (reply.argumentAt<0>() == "off");
-        // emitting valueChanged is needed since subscribeFinished is queued,
-        // and we might need a value immediately (if we blockUntilSubscribed).
-        Q_EMIT valueChanged(ckit::is_screen_blanked, QVariant(blanked));
-        Q_EMIT subscribeFinished(ckit::is_screen_blanked);
-    }
-    pendingCallWatchers.remove(ckit::is_screen_blanked);
-    pcw->deleteLater();
+    if (subscribedKeys.isEmpty() && mceSignals && mceSignals->isStarted())
+        lingerTimer.start(cacheWindow);
 }
 
-/// Callback for "get powersave status"
-void MCEPlugin::getPowerSaveFinished(QDBusPendingCallWatcher* pcw)
+/// Drops the signal match after the cache window. The cached states
+/// are kept, but from now on they may be stale: a subscribe answers
+/// from them and asks MCE again in the background.
+void MCEPlugin::stopTracking()
 {
-    QDBusPendingReply<bool> reply = *pcw;
-    if (reply.isError()) {
-        if (reply.error().type() == QDBusError::ServiceUnknown) {
-            // We need to fail explicitly so that we can emit ready() when the
-            // provider is started. (We have already emitted ready(), and
-            // emitting ready() 2 times has no effect.)
-            Q_EMIT failed("Provider not present: mce");
-        }
-        else
-            Q_EMIT subscribeFailed(ckit::is_psm, reply.error().message());
-    }
-    else {
-        bool on = reply.argumentAt<0>();
-        // emitting valueChanged is needed since subscribeFinished is queued,
-        // and we might need a value immediately (if we blockUntilSubscribed).
-        Q_EMIT valueChanged(ckit::is_psm, QVariant(on));
-        Q_EMIT subscribeFinished(ckit::is_psm);
-    }
-    pendingCallWatchers.remove(ckit::is_psm);
-    pcw->deleteLater();
+    lingerTimer.stop();
+    if (mceSignals)
+        mceSignals->stop();
+    throttleTimer.stop();
+    for (int query = 0; query < QueryCount; ++query)
+        throttled[query] = false;
+}
+
+/// Which query provides the value of \a key, -1 if none.
+int MCEPlugin::queryOf(const QString& key)
+{
+    int query = knownQueryOf(key);
+    return (query >= 0 && mceQueries[query].method) ? query : -1;
+}
+
+/// Which query would provide \a key with a recent enough mce-dev.
+int MCEPlugin::knownQueryOf(const QString& key)
+{
+    if (key == ckit::is_screen_blanked)
+        return DisplayQuery;
+    if (key == ckit::is_psm)
+        return PowerSaveQuery;
+    if (key == ckit::is_offline || key == ckit::is_inet_enabled
+        || key == ckit::is_wlan_enabled)
+        return RadioQuery;
+    if (key == ckit::ambient_light)
+        return AmbientLightQuery;
+    if (key == ckit::is_proximity_covered)
+        return ProximityQuery;
+    if (key == ckit::cpu_mode)
+        return CpuModeQuery;
+    return -1;
+}
+
+/// Computes the value of \a key from the MCE \a state of its query.
+QVariant MCEPlugin::keyValue(const QString& key, const QVariant& state)
+{
+    if (key == ckit::is_screen_blanked)
+        return QVariant(state.toString() == "off");
+    if (key == ckit::is_psm)
+        return QVariant(state.toBool());
+    if (key == ckit::is_offline)
+        return QVariant(!(state.toUInt() & MCE_RADIO_STATE_CELLULAR));
+    if (key == ckit::is_inet_enabled)
+        return QVariant(bool(state.toUInt() & MCE_RADIO_STATE_MASTER));
+    if (key == ckit::is_wlan_enabled)
+        return QVariant(bool(state.toUInt() & MCE_RADIO_STATE_WLAN));
+    if (key == ckit::ambient_light)
+        return QVariant(state.toInt());
+#ifdef MCE_PS_COVERED
+    if (key == ckit::is_proximity_covered)
+        return QVariant(state.toString() == MCE_PS_COVERED);
+#endif
+    if (key == ckit::cpu_mode)
+        return QVariant(state.toString());
+    return QVariant();
 }
 
-/// Callback for "get offline mode status"
-void MCEPlugin::getOfflineModeFinished(QDBusPendingCallWatcher* pcw)
+/// Issues the get-call of \a query unless it is already in flight.
+void MCEPlugin::startQuery(int query)
 {
-    QDBusPendingReply<uint> reply = *pcw;
-    if (reply.isError()) {
-        if (reply.error().type() == QDBusError::ServiceUnknown) {
+    if (pendingQueries[query])
+        return;
+    // this will emit subscribeFinished for all waiting keys when done
+    QDBusPendingCallWatcher* pcw = new QDBusPendingCallWatcher(
+        mce->asyncCall(mceQueries[query].method));
+    sconnect(pcw, SIGNAL(finished(QDBusPendingCallWatcher*)),
+             this, SLOT(queryFinished(QDBusPendingCallWatcher*)));
+    pendingQueries[query] = pcw;
+}
+
+/// Callback for all MCE get-calls
+void MCEPlugin::queryFinished(QDBusPendingCallWatcher* pcw)
+{
+    pcw->deleteLater();
+
+    int query = 0;
+    while (query < QueryCount && pendingQueries[query] != pcw)
+        ++query;
+    if (query == QueryCount)
+        return;
+
+    pendingQueries[query] = 0;
+    QSet<QString> keys = waitingKeys[query];
+    waitingKeys[query].clear();
+
+    if (pcw->isError()) {
+        QDBusError error = pcw->error();
+        if (error.type() == QDBusError::ServiceUnknown) {
             // We need to fail explicitly so that we can emit ready() when the
             // provider is started. (We have already emitted ready(), and
             // emitting ready() 2 times has no effect.)
+            invalidateCache();
             Q_EMIT failed("Provider not present: mce");
         }
         else {
-            Q_EMIT subscribeFailed(ckit::is_offline, reply.error().message());
-            Q_EMIT subscribeFailed(ckit::is_inet_enabled, reply.error().message());
-	    Q_EMIT subscribeFailed(ckit::is_wlan_enabled, reply.error().message());
-	}
+            foreach (const QString& key, keys)
+                Q_EMIT subscribeFailed(key, error.message());
+        }
+        return;
     }
-    else {
-        bool offline = !(reply.argumentAt<0>() & MCE_RADIO_STATE_CELLULAR);
-	bool wlan = (reply.argumentAt<0>() & MCE_RADIO_STATE_WLAN);
-	bool internet = (reply.argumentAt<0>() & MCE_RADIO_STATE_MASTER);
 
+    QVariant state = pcw->reply().arguments().value(0);
+    bool changed = (state != cachedState[query]);
+    storeState(query, state);
+    foreach (const QString& key, keys) {
         // emitting valueChanged is needed since subscribeFinished is queued,
         // and we might need a value immediately (if we blockUntilSubscribed).
-	if (pendingCallWatchers.contains(ckit::is_offline)) {
-	    Q_EMIT valueChanged(ckit::is_offline, QVariant(offline));
-	    Q_EMIT subscribeFinished(ckit::is_offline);
-	}
-
-	if (pendingCallWatchers.contains(ckit::is_inet_enabled)) {
-	    Q_EMIT valueChanged(ckit::is_inet_enabled, QVariant(internet));
-	    Q_EMIT subscribeFinished(ckit::is_inet_enabled);
-	}
-
-	if (pendingCallWatchers.contains(ckit::is_wlan_enabled)) {
-	    Q_EMIT valueChanged(ckit::is_wlan_enabled, QVariant(wlan));
-	    Q_EMIT subscribeFinished(ckit::is_wlan_enabled);
-	}
+        emittedValues.remove(key);
+        emitValue(key, keyValue(key, state));
+        Q_EMIT subscribeFinished(key);
+    }
+    // the other keys were already answered from cache
+    if (changed) {
+        foreach (const QString& key, subscribedKeys)
+            if (queryOf(key) == query && !keys.contains(key))
+                emitValue(key, keyValue(key, state));
     }
-
-    pendingCallWatchers.remove(pendingCallWatchers.key(pcw));
-    pcw->deleteLater();
 }
 
-/// Connected to the D-Bus signal from MCE.
-void MCEPlugin::onDisplayStateChanged(QString state)
+/// Remembers the last known \a state of \a query.
+void MCEPlugin::storeState(int query, const QVariant& state)
 {
-    bool blanked = (state == "off");
-    Q_EMIT valueChanged(ckit::is_screen_blanked, QVariant(blanked));
+    cachedState[query] = state;
 }
 
-/// Connected to the D-Bus signal from MCE.
-void MCEPlugin::onPowerSaveChanged(bool on)
+/// Forgets all cached states, e.g. when MCE has gone away.
+void MCEPlugin::invalidateCache()
 {
-    Q_EMIT valueChanged(ckit::is_psm, QVariant(on));
+    for (int query = 0; query < QueryCount; ++query)
+        cachedState[query] = QVariant();
 }
 
-/// Connected to the D-Bus signal from MCE.
-void MCEPlugin::onOfflineModeChanged(uint state)
+/// Emits \a value of \a key unless it is the one emitted last.
+void MCEPlugin::emitValue(const QString& key, const QVariant& value)
 {
-
-    bool offline = !(state & MCE_RADIO_STATE_CELLULAR);
-    bool wlan = state & MCE_RADIO_STATE_WLAN;
-    bool internet = state & MCE_RADIO_STATE_MASTER;
-
-    if (subscribedRadioProperties.contains(ckit::is_offline))
-	Q_EMIT valueChanged(ckit::is_offline, QVariant(offline));
-
-    if (subscribedRadioProperties.contains(ckit::is_inet_enabled))
-	Q_EMIT valueChanged(ckit::is_inet_enabled, QVariant(internet));
-
-    if (subscribedRadioProperties.contains(ckit::is_wlan_enabled))
-	Q_EMIT valueChanged(ckit::is_wlan_enabled, QVariant(wlan));
+    QHash<QString, QVariant>::iterator it = emittedValues.find(key);
+    if (it != emittedValues.end() && *it == value)
+        return;
+    emittedValues.insert(key, value);
+    Q_EMIT valueChanged(key, value);
 }
 
-/// Implementation of the IPropertyProvider::subscribe.
-void MCEPlugin::subscribe(QSet<QString> keys)
+/// Emits the new values of subscribed keys depending on \a query. For a
+/// query with a minimum interval, changes arriving too early are held
+/// back and only the latest state is emitted when the interval is over.
+void MCEPlugin::emitValues(int query, const QVariant& state)
 {
-    // ensure the connection; it's safe to call this multiple times
-    connectToMce();
+    storeState(query, state);
 
-    if (keys.contains(ckit::is_screen_blanked)) {
-        MCE_PLUGIN_BUS.connect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                              MCE_SIGNAL_IF, MCE_DISPLAY_SIG,
-                              this, SLOT(onDisplayStateChanged(QString)));
-        // this will emit subscribeFinished when done
-        QDBusPendingCallWatcher* pcw = new QDBusPendingCallWatcher(
-            mce->asyncCall(MCE_DISPLAY_STATUS_GET));
-        sconnect(pcw, SIGNAL(finished(QDBusPendingCallWatcher*)),
-                 this, SLOT(getDisplayStatusFinished(QDBusPendingCallWatcher*)));
-        pendingCallWatchers.insert(ckit::is_screen_blanked, pcw);
-
-        ++subscribeCount;
-    }
-    if (keys.contains(ckit::is_psm)) {
-        MCE_PLUGIN_BUS.connect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                              MCE_SIGNAL_IF, MCE_PSM_STATE_SIG,
-                              this, SLOT(onPowerSaveChanged(bool)));
-
-        // this will emit subscribeFinished when done
-        QDBusPendingCallWatcher* pcw = new QDBusPendingCallWatcher(
-            mce->asyncCall(MCE_PSM_STATE_GET));
-        sconnect(pcw, SIGNAL(finished(QDBusPendingCallWatcher*)),
-                 this, SLOT(getPowerSaveFinished(QDBusPendingCallWatcher*)));
-        pendingCallWatchers.insert(ckit::is_psm, pcw);
-
-        ++subscribeCount;
+    // Nothing to throttle or emit if no key of the query is subscribed
+    if (!isSubscribed(query)) {
+        throttled[query] = false;
+        return;
     }
 
-    if (keys.contains(ckit::is_offline)) {
-	initRadioProvider(ckit::is_offline);
-	subscribedRadioProperties.insert(ckit::is_offline);
-	++subscribeCount;
+    int minInterval = mceQueries[query].minInterval;
+    if (minInterval > 0) {
+        qint64 elapsed = lastEmitted[query].isValid() ? lastEmitted[query].elapsed() : minInterval;
+        if (elapsed < minInterval) {
+            throttled[query] = true;
+            if (!throttleTimer.isActive())
+                throttleTimer.start(int(minInterval - elapsed));
+            return;
+        }
+        throttled[query] = false;
+        lastEmitted[query].start();
     }
 
-    if (keys.contains(ckit::is_inet_enabled)) {
-	initRadioProvider(ckit::is_inet_enabled);
-	subscribedRadioProperties.insert(ckit::is_inet_enabled);
-	++subscribeCount;
-    }
+    foreach (const QString& key, subscribedKeys)
+        if (queryOf(key) == query)
+            emitValue(key, keyValue(key, state));
+}
 
-    if (keys.contains(ckit::is_wlan_enabled)) {
-	initRadioProvider(ckit::is_wlan_enabled);
-	subscribedRadioProperties.insert(ckit::is_wlan_enabled);
-	++subscribeCount;
-    }
+/// Whether some subscribed key depends on \a query.
+bool MCEPlugin::isSubscribed(int query) const
+{
+    foreach (const QString& key, subscribedKeys)
+        if (queryOf(key) == query)
+            return true;
+    return false;
 }
 
-void MCEPlugin::initRadioProvider(const QString& key)
+/// Emits the states held back by emitValues.
+void MCEPlugin::emitThrottled()
 {
-    if (subscribedRadioProperties.isEmpty())
-        MCE_PLUGIN_BUS.connect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                              MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG,
-                              this, SLOT(onOfflineModeChanged(uint)));
-
-    if (!subscribedRadioProperties.contains(key)) {
-        // this will emit subscribeFinished when done
-        QDBusPendingCallWatcher* pcw = new QDBusPendingCallWatcher(
-            mce->asyncCall(MCE_RADIO_STATES_GET));
-        sconnect(pcw, SIGNAL(finished(QDBusPendingCallWatcher*)),
-                 this, SLOT(getOfflineModeFinished(QDBusPendingCallWatcher*)));
-        pendingCallWatchers.insert(key, pcw);
-    }
+    for (int query = 0; query < QueryCount; ++query)
+        if (throttled[query])
+            emitValues(query, cachedState[query]);
 }
 
-/// Implementation of the IPropertyProvider::unsubscribe.
-void MCEPlugin::unsubscribe(QSet<QString> keys)
+/// Routed here by the demultiplexer for the change signal of each query.
+void MCEPlugin::onMceSignal(const QDBusMessage& msg)
 {
-    // The Subscribe call can still be in progress.  In that case we'll emit
-    // subscribeFinished later, and the upper layer should just deal with it.
-    if (keys.contains(ckit::is_screen_blanked)) {
-        MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                                 MCE_SIGNAL_IF, MCE_DISPLAY_SIG,
-                                 this, SLOT(onDisplayStateChanged(QString)));
-        --subscribeCount;
-    }
-    if (keys.contains(ckit::is_psm)) {
-        MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                                 MCE_SIGNAL_IF, MCE_PSM_STATE_SIG,
-                                 this, SLOT(onPowerSaveChanged(bool)));
-        --subscribeCount;
+    for (int query = 0; query < QueryCount; ++query) {
+        if (mceQueries[query].signal && msg.member() == mceQueries[query].signal) {
+            emitValues(query, msg.arguments().value(0));
+            return;
+        }
     }
+}
 
-    if (keys.contains(ckit::is_offline)) {
-	subscribedRadioProperties.remove(ckit::is_offline);
-        stopRadioProvider();
-        --subscribeCount;
-    }
+/// Implementation of the IPropertyProvider::subscribe.
+void MCEPlugin::subscribe(QSet<QString> keys)
+{
+    // ensure the connection; it's safe to call this multiple times
+    connectToMce();
+    // listen before querying, so no change is missed in between
+    lingerTimer.stop();
+    bool tracked = mceSignals->isStarted();
+    mceSignals->start();
+
+    foreach (const QString& key, keys) {
+        int query = queryOf(key);
+        if (query < 0) {
+            if (knownQueryOf(key) >= 0)
+                Q_EMIT subscribeFailed(key, "Not supported by this MCE version");
+            continue;
+        }
+        subscribedKeys.insert(key);
 
-    if (keys.contains(ckit::is_inet_enabled)) {
-	subscribedRadioProperties.remove(ckit::is_inet_enabled);
-        stopRadioProvider();
-        --subscribeCount;
-    }
+        if (pendingQueries[query] || !cachedState[query].isValid()) {
+            waitingKeys[query].insert(key);
+            // keys of the same query share one call
+            startQuery(query);
+            continue;
+        }
 
-    if (keys.contains(ckit::is_wlan_enabled)) {
-	subscribedRadioProperties.remove(ckit::is_wlan_enabled);
-        stopRadioProvider();
-        --subscribeCount;
+        // Complete from cache. subscribeFinished is queued by the upper
+        // layer, so emitting it from here is fine.
+        emittedValues.remove(key);
+        emitValue(key, keyValue(key, cachedState[query]));
+        Q_EMIT subscribeFinished(key);
+        // Past the cache window the signals were not followed and we may
+        // have missed changes; ask MCE again in the background.
+        if (!tracked)
+            startQuery(query);
     }
-
-    if (subscribeCount == 0)
-        disconnectFromMce();
+    lingerIfIdle();
 }
 
-void MCEPlugin::stopRadioProvider()
+/// Implementation of the IPropertyProvider::unsubscribe.
+void MCEPlugin::unsubscribe(QSet<QString> keys)
 {
-    if (subscribedRadioProperties.isEmpty()) {
-
-        MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                                 MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG,
-                                 this, SLOT(onOfflineModeChanged(uint)));
+    // The Subscribe call can still be in progress.  In that case we'll emit
+    // subscribeFinished later, and the upper layer should just deal with it.
+    foreach (const QString& key, keys) {
+        subscribedKeys.remove(key);
+        emittedValues.remove(key);
+    }
+    // Changes held back for keys which are gone are not emitted
+    bool anyThrottled = false;
+    for (int query = 0; query < QueryCount; ++query) {
+        if (throttled[query] && !isSubscribed(query))
+            throttled[query] = false;
+        anyThrottled |= throttled[query];
     }
+    if (!anyThrottled)
+        throttleTimer.stop();
+    // The interface and the service watcher are kept; the signal match
+    // goes cacheWindow after the last key.
+    lingerIfIdle();
 }
 
-
 void MCEPlugin::blockUntilReady()
 {
     // This plugin is optimistic, it's ready even if we don't know whether MCE
@@ -336,10 +432,9 @@ void MCEPlugin::blockUntilReady()
 
 void MCEPlugin::blockUntilSubscribed(const QString& key)
 {
-    if (pendingCallWatchers.contains(key)) {
-        QDBusPendingCallWatcher* pcw = pendingCallWatchers.value(key);
-        pcw->waitForFinished();
-    }
+    int query = queryOf(key);
+    if (query >= 0 && pendingQueries[query] && waitingKeys[query].contains(key))
+        pendingQueries[query]->waitForFinished();
 }
 
 /// For emitting the failed() signal in a delayed way.  When the plugin has emitted failed(), it's
@@ -348,19 +443,11 @@ void MCEPlugin::emitFailed(QString reason)
 {
     // Don't disconnectFromMce here; that would kill the D-Bus name watcher and we wouldn't notice
     // when MCE comes back.
-    MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                             MCE_SIGNAL_IF, MCE_DISPLAY_SIG,
-                             this, SLOT(onDisplayStateChanged(QString)));
-    MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                             MCE_SIGNAL_IF, MCE_PSM_STATE_SIG,
-                             this, SLOT(onPowerSaveChanged(bool)));
-    MCE_PLUGIN_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH,
-                             MCE_SIGNAL_IF, MCE_RADIO_STATES_SIG,
-                             this, SLOT(onOfflineModeChanged(uint)));
-
-    subscribeCount = 0;
+    subscribedKeys.clear();
+    emittedValues.clear();
+    stopTracking();
+    invalidateCache();
     Q_EMIT failed(reason);
 }
 
 } // end namespace
-
@@ -29,6 +29,10 @@
 #include <QDBusInterface>
 #include <QString>
 #include <QSet>
+#include <QVariant>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class QDBusServiceWatcher;
 
@@ -40,6 +44,8 @@ extern "C" {
 
 class AsyncDBusInterface; // From libcontextsubscriber-dev
 class QDBusPendingCallWatcher;
+class QDBusMessage;
+class DBusSignalDemux;
 
 namespace ContextSubscriberMCE
 {
@@ -48,7 +54,8 @@ namespace ContextSubscriberMCE
   \class MCEPlugin
 
   \brief A libcontextsubscriber plugin for communicating with MCE
-  over D-Bus. Provides the context properties Screen.Blanked and Device.PowerSaveMode.
+  over D-Bus. Provides Screen.Blanked, the System.* modes, the ambient light
+  and proximity sensor state and the CPU mode.
 
  */
 
@@ -58,33 +65,56 @@ class MCEPlugin : public IProviderPlugin
 
 public:
     explicit MCEPlugin();
+    virtual ~MCEPlugin();
     virtual void subscribe(QSet<QString> keys);
     virtual void unsubscribe(QSet<QString> keys);
     virtual void blockUntilReady();
     virtual void blockUntilSubscribed(const QString& key);
 
 private Q_SLOTS:
-    void getDisplayStatusFinished(QDBusPendingCallWatcher* pcw);
-    void getPowerSaveFinished(QDBusPendingCallWatcher* pcw);
-    void getOfflineModeFinished(QDBusPendingCallWatcher* pcw);
-    void onDisplayStateChanged(QString state);
-    void onPowerSaveChanged(bool on);
-    void onOfflineModeChanged(uint state);
-    void onInternetEnabledKeyChanged(uint state);
-    void onWlanEnabledKeyChanged(uint state);
+    void queryFinished(QDBusPendingCallWatcher* pcw);
+    void onMceSignal(const QDBusMessage& msg);
+    void emitThrottled();
+    void stopTracking();
     void emitFailed(QString reason = QString("Provider not present: mce"));
 
 private:
+    /// MCE get-calls backing the context properties. One reply (and one
+    /// change signal) serves every key mapped to the same query.
+    enum Query {DisplayQuery, PowerSaveQuery, RadioQuery,
+                AmbientLightQuery, ProximityQuery, CpuModeQuery, QueryCount};
+
+    static int queryOf(const QString& key);
+    static int knownQueryOf(const QString& key);
+    static QVariant keyValue(const QString& key, const QVariant& state);
     void connectToMce();
     void disconnectFromMce();
-    void initRadioProvider(const QString& key);
-    void stopRadioProvider();
+    void lingerIfIdle();
+    void startQuery(int query);
+    void emitValue(const QString& key, const QVariant& value);
+    void emitValues(int query, const QVariant& state);
+    bool isSubscribed(int query) const;
+    void storeState(int query, const QVariant& state);
+    void invalidateCache();
     AsyncDBusInterface* mce;
 
     QDBusServiceWatcher* serviceWatcher; ///< For watching MCE appear and disappear
-    int subscribeCount;
-    QSet<QString> subscribedRadioProperties;
-    QHash<QString, QDBusPendingCallWatcher*> pendingCallWatchers;
+    DBusSignalDemux* mceSignals; ///< The single match rule for all MCE signals, while subscribed or lingering
+    QSet<QString> subscribedKeys; ///< What the upper layer wants us to be subscribed to
+    QDBusPendingCallWatcher* pendingQueries[QueryCount]; ///< In-flight call per query
+    QSet<QString> waitingKeys[QueryCount]; ///< Keys waiting for the in-flight call
+
+    /// Last known MCE state per query, kept current by the change signals
+    /// while they are followed, possibly stale after that. Invalid if
+    /// never known or MCE went away.
+    QVariant cachedState[QueryCount];
+    QHash<QString, QVariant> emittedValues; ///< Last value emitted per subscribed key
+
+    QElapsedTimer lastEmitted[QueryCount]; ///< For queries with a minimum interval
+    bool throttled[QueryCount]; ///< A held back state is waiting for throttleTimer
+    QTimer throttleTimer;
+    QTimer lingerTimer; ///< Keeps the signals followed for cacheWindow after the last unsubscribe
+    int cacheWindow; ///< How long (ms) the signals are followed with nothing subscribed
 };
 }
 
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "mceclient.h"
+#include "sconnect.h"
+#include "logging.h"
+
+#include <mce/dbus-names.h> // from mce-dev
+#include <mce/mode-names.h> // from mce-dev
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+
+#define MCE_CLIENT_BUS QDBusConnection::systemBus()
+
+MceClient::MceClient(QObject* parent)
+    : QObject(parent), serviceWatcher(0), pendingQuery(0)
+{
+}
+
+MceClient::~MceClient()
+{
+    stop();
+}
+
+/// Starts tracking the display state; safe to call multiple times.
+void MceClient::start()
+{
+    if (serviceWatcher)
+        return;
+
+    serviceWatcher = new QDBusServiceWatcher(MCE_SERVICE, MCE_CLIENT_BUS,
+                                             QDBusServiceWatcher::WatchForOwnerChange, this);
+    sconnect(serviceWatcher, SIGNAL(serviceRegistered(const QString&)),
+             this, SLOT(queryDisplayStatus()));
+    sconnect(serviceWatcher, SIGNAL(serviceUnregistered(const QString&)),
+             this, SLOT(onMceUnregistered()));
+
+    // Listen before asking, so that no change is lost in between
+    MCE_CLIENT_BUS.connect(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_DISPLAY_SIG,
+                           this, SLOT(onDisplaySignal(const QString&)));
+
+    queryDisplayStatus();
+}
+
+/// Asks MCE for the display state, unless already asking.
+void MceClient::queryDisplayStatus()
+{
+    if (pendingQuery)
+        return;
+    QDBusMessage msg = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH,
+                                                      MCE_REQUEST_IF, MCE_DISPLAY_STATUS_GET);
+    pendingQuery = new QDBusPendingCallWatcher(MCE_CLIENT_BUS.asyncCall(msg), this);
+    sconnect(pendingQuery, SIGNAL(finished(QDBusPendingCallWatcher*)),
+             this, SLOT(displayStatusFinished(QDBusPendingCallWatcher*)));
+}
+
+/// Stops tracking; the state becomes unknown.
+void MceClient::stop()
+{
+    if (!serviceWatcher)
+        return;
+    MCE_CLIENT_BUS.disconnect(MCE_SERVICE, MCE_SIGNAL_PATH, MCE_SIGNAL_IF, MCE_DISPLAY_SIG,
+                              this, SLOT(onDisplaySignal(const QString&)));
+    delete pendingQuery;
+    pendingQuery = 0;
+    delete serviceWatcher;
+    serviceWatcher = 0;
+    state.clear();
+}
+
+/// The last known display state ("on", "dimmed" or "off"), or empty.
+QString MceClient::displayState() const
+{
+    return state;
+}
+
+bool MceClient::isDisplayOff() const
+{
+    return state == MCE_DISPLAY_OFF_STRING;
+}
+
+void MceClient::setDisplayState(const QString& newState)
+{
+    if (newState == state)
+        return;
+    state = newState;
+    Q_EMIT displayStateChanged();
+}
+
+void MceClient::onDisplaySignal(const QString& displayState)
+{
+    // The signal is newer than any reply still on its way
+    delete pendingQuery;
+    pendingQuery = 0;
+    setDisplayState(displayState);
+}
+
+void MceClient::displayStatusFinished(QDBusPendingCallWatcher* pcw)
+{
+    pendingQuery = 0;
+    pcw->deleteLater();
+
+    QDBusPendingReply<QString> reply = *pcw;
+    if (reply.isError()) {
+        contextWarning() << "Cannot get display status from MCE:" << reply.error().message();
+        return;
+    }
+    setDisplayState(reply.argumentAt<0>());
+}
+
+void MceClient::onMceUnregistered()
+{
+    setDisplayState(QString());
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010 Nokia Corporation.
+ *
+ * Contact: Marius Vollmer <marius.vollmer@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef MCECLIENT_H
+#define MCECLIENT_H
+
+#include <QObject>
+#include <QString>
+
+class QDBusPendingCallWatcher;
+class QDBusServiceWatcher;
+
+/*!
+  \class MceClient
+
+  \brief Direct access to the MCE display state for plugins which
+  need it internally, without subscribing to Screen.Blanked through
+  libcontextsubscriber.
+
+  Between start() and stop() the display state is cached: fetched
+  once asynchronously, then kept current by the MCE display signal,
+  the only MCE signal listened to.
+  The state is empty while unknown, e.g. before the first reply or
+  when MCE is not running.
+ */
+class MceClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MceClient(QObject* parent = 0);
+    virtual ~MceClient();
+
+    void start();
+    void stop();
+
+    QString displayState() const;
+    bool isDisplayOff() const;
+
+Q_SIGNALS:
+    void displayStateChanged();
+
+private Q_SLOTS:
+    void onDisplaySignal(const QString& displayState);
+    void displayStatusFinished(QDBusPendingCallWatcher* pcw);
+    void queryDisplayStatus();
+    void onMceUnregistered();
+
+private:
+    void setDisplayState(const QString& state);
+
+    QDBusServiceWatcher* serviceWatcher; ///< For forgetting the state when MCE goes away; non-null while started
+    QDBusPendingCallWatcher* pendingQuery; ///< The in-flight display status query
+    QString state; ///< Cached display state
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "sessionplugin.h"
 #include "sconnect.h"
 #include <QSocketNotifier>
+#include <stdlib.h>
 #include <contextkit_props/session.hpp>
 
 // How many fixed windows we always have on the top (possibly not
@@ -41,16 +42,24 @@ namespace ContextSubscriberSessionState {
 
 namespace ckit = contextkit::session;
 
-/// Typedef for Xlib error handling functions
-typedef int (*xerrfunc)(Display*, XErrorEvent*);
+/// How many unknown windows from the top of the stack are queried in
+/// one pipelined batch. Usually the first viewable window decides, so
+/// one batch (one round trip of latency) is enough.
+#define QUERY_BATCH 8
 
-/// Handler for X errors. All errors are ignored: we cannot do any
-/// sophisticated handling, but we don't want the client process to
-/// exit in case of errors.
-int onXError(Display*, XErrorEvent*)
+/// Default for how long (ms) X events are collected before the
+/// fullscreen status is recomputed; about two frames. Overridable with
+/// CONTEXT_SESSION_RECOMPUTE_INTERVAL.
+#define RECOMPUTE_INTERVAL 32
+
+/// The requests issued for one window in queryWindows
+struct WindowCookies
 {
-    return 0;
-}
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_geometry_cookie_t geometry;
+    xcb_get_property_cookie_t type;
+    xcb_get_property_cookie_t state;
+};
 
 /// Constructor. Opens the X display and creates the atoms. When this
 /// is done, the "ready" signal is scheduled to be emitted (we cannot
@@ -58,178 +67,381 @@ int onXError(Display*, XErrorEvent*)
 SessionStatePlugin::SessionStatePlugin()
     : sessionStateKey(ckit::state),
       fullscreen(false),
-      screenBlanked("Screen.Blanked")
+      subscribed(false),
+      stackingChanged(false),
+      windowChanged(false),
+      root(XCB_NONE)
 {
+    const char *interval = getenv("CONTEXT_SESSION_RECOMPUTE_INTERVAL");
+    recomputeTimer.setInterval(interval ? atoi(interval) : RECOMPUTE_INTERVAL);
+    recomputeTimer.setSingleShot(true);
+    sconnect(&recomputeTimer, SIGNAL(timeout()), this, SLOT(recompute()));
+
     // Initialize the objects needed when communicating via X.
-    dpy = XOpenDisplay(0);
-    if (dpy == 0) {
+    int screenNumber = 0;
+    xcb = xcb_connect(0, &screenNumber);
+    if (xcb_connection_has_error(xcb)) {
+        xcb_disconnect(xcb);
+        xcb = 0;
         // we can't emit failed() here; nobody is connected. Queue it.
         QMetaObject::invokeMethod(this, "failed", Qt::QueuedConnection,
                                   Q_ARG(QString, "Cannot open display"));
         return;
     }
 
-    clientListStackingAtom = XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
-    stateAtom = XInternAtom(dpy, "_NET_WM_STATE", False);
-    fullScreenAtom = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
-    windowTypeAtom = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
-    windowTypeDesktopAtom = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DESKTOP", False);
-    windowTypeNotificationAtom = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_NOTIFICATION", False);
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(xcb));
+    for (; screens.rem && screenNumber > 0; --screenNumber)
+        xcb_screen_next(&screens);
+    root = screens.data->root;
+
+    // All atoms in one round trip
+#define INTERN(name) xcb_intern_atom(xcb, 0, sizeof(name) - 1, name)
+    xcb_intern_atom_cookie_t cookies[] = {
+        INTERN("_NET_CLIENT_LIST_STACKING"),
+        INTERN("_NET_WM_STATE"),
+        INTERN("_NET_WM_STATE_FULLSCREEN"),
+        INTERN("_NET_WM_WINDOW_TYPE"),
+        INTERN("_NET_WM_WINDOW_TYPE_DESKTOP"),
+        INTERN("_NET_WM_WINDOW_TYPE_NOTIFICATION")
+    };
+#undef INTERN
+    clientListStackingAtom = internAtom(cookies[0]);
+    stateAtom = internAtom(cookies[1]);
+    fullScreenAtom = internAtom(cookies[2]);
+    windowTypeAtom = internAtom(cookies[3]);
+    windowTypeDesktopAtom = internAtom(cookies[4]);
+    windowTypeNotificationAtom = internAtom(cookies[5]);
 
     // Fetch the fd used for communicating with X and start listening
     // to it
-    xNotifier = new QSocketNotifier(ConnectionNumber(dpy), QSocketNotifier::Read, this);
+    xNotifier = new QSocketNotifier(xcb_get_file_descriptor(xcb), QSocketNotifier::Read, this);
     sconnect(xNotifier, SIGNAL(activated(int)), this, SLOT(onXEvent()));
 
     // Emitting ready() is not allowed inside the constructor. Thus,
     // queue it.
     QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 
-    // Connect to the screen blanking property
-    sconnect(&screenBlanked, SIGNAL(valueChanged()), this, SLOT(emitValueChanged()));
-
-    // From the start, the screen blanking property doesn't need to be
-    // subscribed
-    screenBlanked.unsubscribe();
+    // Listen to the display state directly from MCE (only while
+    // subscribed)
+    sconnect(&mce, SIGNAL(displayStateChanged()), this, SLOT(emitValueChanged()));
 }
 
 /// Destructor.
 SessionStatePlugin::~SessionStatePlugin()
 {
-    XCloseDisplay(dpy);
-    dpy = 0;
+    if (xcb)
+        xcb_disconnect(xcb);
+    xcb = 0;
 }
 
-/// Check whether the top-most window is in a fullscreen state. We
-/// ignore a specified amount of windows which are always fixed on
-/// top, see #define's. Schedules a valueChanged signal to be emitted
-/// if the fullscreen status if found out.
-void SessionStatePlugin::checkFullScreen()
+/// Waits for the reply of an intern atom request.
+xcb_atom_t SessionStatePlugin::internAtom(xcb_intern_atom_cookie_t cookie)
 {
-    if (dpy == 0) {
-        contextWarning() << "Display == 0";
-        return;
+    xcb_atom_t atom = XCB_ATOM_NONE;
+    xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(xcb, cookie, 0);
+    if (reply) {
+        atom = reply->atom;
+        free(reply);
     }
+    return atom;
+}
+
+/// Whether the _NET_WM_WINDOW_TYPE \a reply allows the window to
+/// decide the fullscreen status: desktop and notification windows
+/// don't.
+bool SessionStatePlugin::isInterestingType(xcb_get_property_reply_t* reply) const
+{
+    xcb_atom_t* types = (xcb_atom_t*)xcb_get_property_value(reply);
+    int count = int(xcb_get_property_value_length(reply) / sizeof(xcb_atom_t));
+    for (int t = 0; t < count; ++t)
+        if (types[t] == windowTypeDesktopAtom || types[t] == windowTypeNotificationAtom)
+            return false;
+    return true;
+}
+
+/// Whether the _NET_WM_STATE \a reply contains the fullscreen state.
+bool SessionStatePlugin::isFullScreenState(xcb_get_property_reply_t* reply) const
+{
+    xcb_atom_t* states = (xcb_atom_t*)xcb_get_property_value(reply);
+    int count = int(xcb_get_property_value_length(reply) / sizeof(xcb_atom_t));
+    for (int s = 0; s < count; ++s)
+        if (states[s] == fullScreenAtom)
+            return true;
+    return false;
+}
 
-    Atom actualType;
-    int actualFormat;
-    unsigned long numWindows, bytesLeft;
-    unsigned char* windowData = 0;
-
-    // Set the error handler. A common situation is that we get a
-    // stacking client list from X, and while we are processing that
-    // list, a client has already exited. This will result in an
-    // BadWindow error.
-    xerrfunc oldHandler = XSetErrorHandler(onXError);
-
-    // Get the stacking list of clients from the root window
-    int result = XGetWindowProperty(dpy, DefaultRootWindow(dpy), clientListStackingAtom,
-                                    0, 0x7fffffff, False, XA_WINDOW,
-                                    &actualType, &actualFormat, &numWindows, &bytesLeft, &windowData);
-
-    if (result != Success || windowData == None) {
-        // Set back the old error handler
-        XSync(dpy, False);
-        XSetErrorHandler(oldHandler);
+/// Fetches _NET_CLIENT_LIST_STACKING and diffs it against the cached
+/// list: windows which are gone are dropped from the window cache (and
+/// no longer listened to), new windows are left to be queried on
+/// demand by updateFullScreen().
+void SessionStatePlugin::updateStacking()
+{
+    xcb_get_property_reply_t* reply = xcb_get_property_reply(
+        xcb, xcb_get_property(xcb, 0, root, clientListStackingAtom,
+                              XCB_ATOM_WINDOW, 0, 0x7fffffff), 0);
+    if (reply == 0)
         return;
-    }
 
-    fullscreen = false;
-    // Start reading the windows from the top
-    Window *wins = (Window *)windowData;
-    for (long i = numWindows - 1 - FIXED_ON_TOP; i >= 0; --i) {
-        // TODO: Is it enough to listen to the root window for
-        // _NET_CLIENT_LIST_STACKING? Or should we listen to other windows
-        // as well?
-
-        // Check the window attributes. If the window is unmapped or
-        // 0-sized, we're not interested in it.
-        XWindowAttributes winAttr;
-        if (XGetWindowAttributes(dpy, wins[i], &winAttr) == 0) continue;
-        if (winAttr.width == 0 || winAttr.height == 0) continue;
-        if (winAttr.c_class != InputOutput || winAttr.map_state != IsViewable) continue;
-
-        // Check the window type. If it is a desktop window or a
-        // notification window, we're not interested.
-        bool interesting = true;
-        unsigned char *data = 0;
-        unsigned long count = 0;
-
-        result = XGetWindowProperty(dpy, wins[i], windowTypeAtom,
-                                    0L, 16L, False, XA_ATOM,
-                                    &actualType, &actualFormat, &count, &bytesLeft, &data);
-        if (result != Success) continue;
-
-        Atom *types = (Atom *)data;
-        for (unsigned int t = 0; t < count; ++t) {
-            if (types[t] == windowTypeDesktopAtom || types[t] == windowTypeNotificationAtom) {
-                interesting = false;
-                break;
-            }
-        }
+    xcb_window_t* wins = (xcb_window_t*)xcb_get_property_value(reply);
+    int count = int(xcb_get_property_value_length(reply) / sizeof(xcb_window_t));
+    QVector<xcb_window_t> newStack(count);
+    qCopy(wins, wins + count, newStack.begin());
+    free(reply);
+
+    if (newStack == stack)
+        return;
 
-        XFree(data);
-        data = 0;
+    QSet<xcb_window_t> present;
+    foreach (xcb_window_t win, newStack)
+        present.insert(win);
+    foreach (xcb_window_t win, stack) {
+        if (!present.contains(win) && windows.remove(win))
+            selectWindowEvents(win, false);
+    }
+    stack = newStack;
+}
 
-        if (!interesting) continue;
+/// Starts or stops listening to the changes of \a win relevant to the
+/// fullscreen status. If the window is already gone the error is
+/// ignored (it comes as an event to onXEvent).
+void SessionStatePlugin::selectWindowEvents(xcb_window_t win, bool on)
+{
+    uint32_t mask = on ? (XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY)
+        : XCB_EVENT_MASK_NO_EVENT;
+    xcb_change_window_attributes(xcb, win, XCB_CW_EVENT_MASK, &mask);
+}
 
-        // Check the window state; whether it's fullscreen or not
-        result = XGetWindowProperty (dpy, wins[i], stateAtom,
-                                     0L, 16L, False, XA_ATOM,
-                                     &actualType, &actualFormat, &count, &bytesLeft, &data);
+/// Stops listening to all tracked windows and forgets about them.
+void SessionStatePlugin::clearWindows()
+{
+    foreach (xcb_window_t win, windows.keys())
+        selectWindowEvents(win, false);
+    windows.clear();
+    stack.clear();
+}
 
-        if (result != Success) continue;
+/// Queries the windows in \a wins with all requests pipelined, and
+/// stores the results in the window cache. The windows are also
+/// selected for change events, before the queries, so that no change
+/// can slip in between.
+void SessionStatePlugin::queryWindows(const QVector<xcb_window_t>& wins)
+{
+    QVector<WindowCookies> cookies(wins.size());
+    for (int i = 0; i < wins.size(); ++i) {
+        xcb_window_t win = wins[i];
+        if (!windows.contains(win))
+            selectWindowEvents(win, true);
+        cookies[i].attributes = xcb_get_window_attributes(xcb, win);
+        cookies[i].geometry = xcb_get_geometry(xcb, win);
+        cookies[i].type = xcb_get_property(xcb, 0, win, windowTypeAtom,
+                                           XCB_ATOM_ATOM, 0, 16);
+        cookies[i].state = xcb_get_property(xcb, 0, win, stateAtom,
+                                            XCB_ATOM_ATOM, 0, 16);
+    }
+
+    for (int i = 0; i < wins.size(); ++i) {
+        xcb_get_window_attributes_reply_t* attr =
+            xcb_get_window_attributes_reply(xcb, cookies[i].attributes, 0);
+        xcb_get_geometry_reply_t* geometry =
+            xcb_get_geometry_reply(xcb, cookies[i].geometry, 0);
+        xcb_get_property_reply_t* type =
+            xcb_get_property_reply(xcb, cookies[i].type, 0);
+        xcb_get_property_reply_t* state =
+            xcb_get_property_reply(xcb, cookies[i].state, 0);
+
+        // A window which vanished meanwhile is remembered as
+        // uninteresting; the next stacking change removes it.
+        WindowInfo& info = windows[wins[i]];
+        info.valid = true;
+        info.viewable = attr && attr->_class == XCB_WINDOW_CLASS_INPUT_OUTPUT
+            && attr->map_state == XCB_MAP_STATE_VIEWABLE;
+        info.sized = geometry && geometry->width != 0 && geometry->height != 0;
+        info.interesting = type && isInterestingType(type);
+        info.fullscreen = state && isFullScreenState(state);
+
+        free(attr);
+        free(geometry);
+        free(type);
+        free(state);
+    }
+}
 
-        Atom *states = (Atom *)data;
-        for (unsigned int s = 0; s < count; ++s) {
-            if (states[s] == fullScreenAtom) {
-                fullscreen = true;
+/// Check whether the top-most window is in a fullscreen state. We
+/// ignore a specified amount of windows which are always fixed on
+/// top, see #define's.
+///
+/// Only windows not in the cache (new or changed since) are queried,
+/// QUERY_BATCH at a time and pipelined, and only those above the first
+/// window known to decide. With an up-to-date cache this needs no X
+/// round trips at all.
+void SessionStatePlugin::updateFullScreen()
+{
+    forever {
+        QVector<xcb_window_t> unknown;
+        bool decided = false;
+        // Start reading the windows from the top
+        for (int i = stack.size() - 1 - FIXED_ON_TOP; i >= 0; --i) {
+            QHash<xcb_window_t, WindowInfo>::const_iterator it = windows.constFind(stack[i]);
+            if (it == windows.constEnd() || !it->valid) {
+                unknown.append(stack[i]);
+                if (unknown.size() == QUERY_BATCH)
+                    break;
+                continue;
             }
+            // If the window is unmapped or 0-sized, we're not interested
+            // in it. Neither if it is a desktop window or a notification
+            // window.
+            if (!it->viewable || !it->sized || !it->interesting)
+                continue;
+            // This window we're looking at is enough to determine
+            // whether we're fullscreen or not, unless some window above
+            // it is yet unknown.
+            if (unknown.isEmpty())
+                fullscreen = it->fullscreen;
+            decided = true;
+            break;
         }
-        XFree(data);
-        data = 0;
 
-        // This window we're looking at is enough to determine whether
-        // we're fullscreen or not.
-        break;
+        if (unknown.isEmpty()) {
+            if (!decided)
+                fullscreen = false;
+            return;
+        }
+        queryWindows(unknown);
+    }
+}
+
+/// Check the fullscreen status from scratch wrt. the stacking order.
+/// Schedules a valueChanged signal to be emitted.
+void SessionStatePlugin::checkFullScreen()
+{
+    if (xcb == 0) {
+        contextWarning() << "Display == 0";
+        return;
     }
 
+    updateStacking();
+    updateFullScreen();
+    drainXEvents();
+
     // The valueChanged is emitted in a delayed way, since this
     // function is called from subscribe, and emitting valueChanged
     // there makes libcontextsubscriber block.
     QMetaObject::invokeMethod(this, "emitValueChanged", Qt::QueuedConnection);
-
-    XFree(windowData);
-
-    // Set back the old error handler
-    XSync(dpy, False);
-    XSetErrorHandler(oldHandler);
 }
 
-/// Check whether Xlib has an event for us. If so, process it: check
-/// whether the stacking order of the root window has changed, and if
-/// so, check the fullscreen status again.
+/// Check whether X has sent events for us. If so, process them: a
+/// change in the stacking order of the root window, or in the state,
+/// type, mapping or size of a tracked window. Only the cache is
+/// updated here; the fullscreen status is recomputed by recompute(),
+/// at most once per recomputeTimer interval however many events come
+/// in (e.g., during window animations).
 void SessionStatePlugin::onXEvent()
 {
-    XEvent event;
-    int numEvents = XEventsQueued(dpy, QueuedAfterReading);
-    if (numEvents <= 0) {
-	return;
+    drainXEvents();
+}
+
+/// Handles all the X events xcb has already read, and schedules
+/// recompute() if some of them invalidated the cache. Besides
+/// onXEvent, this must be called after every pass which waits for
+/// replies: xcb reads the events arriving meanwhile into its queue,
+/// and the socket notifier would not fire for them anymore.
+void SessionStatePlugin::drainXEvents()
+{
+    xcb_generic_event_t* event;
+    // Drain everything that has arrived; xcb_poll_for_event never blocks
+    while ((event = xcb_poll_for_event(xcb)) != 0) {
+        // Events still arriving after unsubscribe are of no use
+        if (subscribed)
+            handleXEvent(event);
+        free(event);
+    }
+
+    // A broken connection keeps the socket readable forever but never
+    // delivers another event; don't spin on it
+    if (xcb_connection_has_error(xcb)) {
+        if (xNotifier->isEnabled()) {
+            contextWarning() << "Lost the connection to X";
+            xNotifier->setEnabled(false);
+            recomputeTimer.stop();
+            Q_EMIT failed("Lost the connection to X");
+        }
+        return;
     }
 
-    for (int i=0; i < numEvents; ++i) {
-        // This blocks until we get an event, but now there should be one
-        XNextEvent(dpy, &event);
+    if ((stackingChanged || windowChanged) && !recomputeTimer.isActive())
+        recomputeTimer.start();
+}
 
-        if (event.type == PropertyNotify && event.xproperty.window == DefaultRootWindow(dpy)
-            && event.xproperty.atom == clientListStackingAtom) {
-            // We're anyway going to check the full screen status;
-            // no need to check the other events we possibly have
-            cleanXEventQueue();
-            checkFullScreen();
-            break;
+/// Updates the window cache according to \a event.
+void SessionStatePlugin::handleXEvent(xcb_generic_event_t* event)
+{
+    switch (event->response_type & ~0x80) {
+    case XCB_PROPERTY_NOTIFY: {
+        xcb_property_notify_event_t* e = (xcb_property_notify_event_t*)event;
+        if (e->window == root) {
+            if (e->atom == clientListStackingAtom)
+                stackingChanged = true;
+        }
+        else if (e->atom == stateAtom || e->atom == windowTypeAtom) {
+            windowChanged |= invalidateWindow(e->window);
+        }
+        break;
+    }
+    case XCB_CONFIGURE_NOTIFY: {
+        xcb_configure_notify_event_t* e = (xcb_configure_notify_event_t*)event;
+        QHash<xcb_window_t, WindowInfo>::iterator it = windows.find(e->window);
+        if (it != windows.end()) {
+            bool sized = (e->width != 0 && e->height != 0);
+            windowChanged |= (it->sized != sized);
+            it->sized = sized;
+        }
+        break;
+    }
+    case XCB_MAP_NOTIFY:
+        windowChanged |= invalidateWindow(((xcb_map_notify_event_t*)event)->window);
+        break;
+    case XCB_UNMAP_NOTIFY:
+        windowChanged |= invalidateWindow(((xcb_unmap_notify_event_t*)event)->window);
+        break;
+    case XCB_DESTROY_NOTIFY: {
+        // Known to be uninteresting until it drops off the stacking list
+        xcb_destroy_notify_event_t* e = (xcb_destroy_notify_event_t*)event;
+        QHash<xcb_window_t, WindowInfo>::iterator it = windows.find(e->window);
+        if (it != windows.end()) {
+            *it = WindowInfo();
+            it->valid = true;
+            windowChanged = true;
         }
+        break;
     }
+    default:
+        // errors (response_type 0) about vanished windows end up here
+        break;
+    }
+}
+
+/// Recomputes the fullscreen status after the X events collected by
+/// onXEvent, and emits Session.State if it changed.
+void SessionStatePlugin::recompute()
+{
+    if (stackingChanged)
+        updateStacking();
+    updateFullScreen();
+    stackingChanged = windowChanged = false;
+    drainXEvents();
+    emitValueChanged();
+}
+
+/// Marks the cached info of \a win to be queried again. Returns whether
+/// the window is tracked at all.
+bool SessionStatePlugin::invalidateWindow(xcb_window_t win)
+{
+    QHash<xcb_window_t, WindowInfo>::iterator it = windows.find(win);
+    if (it == windows.end())
+        return false;
+    it->valid = false;
+    return true;
 }
 
 /// Implementation of the IProviderPlugin::subscribe function. If the
@@ -247,17 +459,21 @@ void SessionStatePlugin::subscribe(QSet<QString> keys)
 
     if (keys.contains(sessionStateKey)) {
 
+        subscribed = true;
+        // The first value is always emitted
+        emittedState.clear();
         checkFullScreen(); // This also queues the valueChanged signal
 
         // Now the value is there; signal that the subscription is done.
         emit subscribeFinished(sessionStateKey);
 
         // Start listening to changes in the client list
-        XSelectInput(dpy, DefaultRootWindow(dpy), PropertyChangeMask);
-        XFlush(dpy);
+        uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+        xcb_change_window_attributes(xcb, root, XCB_CW_EVENT_MASK, &mask);
+        xcb_flush(xcb);
 
         // Start listening to the screen blanking status
-        screenBlanked.subscribe();
+        mce.start();
     }
 }
 
@@ -267,24 +483,35 @@ void SessionStatePlugin::unsubscribe(QSet<QString> keys)
 {
     if (keys.contains(sessionStateKey)) {
 
+        subscribed = false;
+        recomputeTimer.stop();
+        stackingChanged = windowChanged = false;
+
         // Stop listening to changes in the client list
-        XSelectInput(dpy, DefaultRootWindow(dpy), NoEventMask);
-        XFlush(dpy);
+        uint32_t mask = XCB_EVENT_MASK_NO_EVENT;
+        xcb_change_window_attributes(xcb, root, XCB_CW_EVENT_MASK, &mask);
+        xcb_flush(xcb);
+
+        // Stop listening to the windows; the cache would go stale
+        clearWindows();
+        xcb_flush(xcb);
 
-        // Clean the event queue so that we don't have old events when
-        // a new subscripton comes
-        cleanXEventQueue();
+        // Events already on their way are drained and dropped by
+        // onXEvent, so they don't get processed if the property is
+        // re-subscribed.
 
         // Stop listening to the screen blanking status
-        screenBlanked.unsubscribe();
+        mce.stop();
     }
 }
 
 void SessionStatePlugin::blockUntilReady()
 {
     // This plugin is ready immediately... unless it has failed.
-    if (dpy == 0)
+    if (xcb == 0)
         Q_EMIT failed("Cannot open display");
+    else if (xcb_connection_has_error(xcb))
+        Q_EMIT failed("Lost the connection to X");
     else
         Q_EMIT ready();
 }
@@ -293,39 +520,28 @@ void SessionStatePlugin::blockUntilSubscribed(const QString&)
 {
     // subscribe() has called checkFullScreen (which has queued
     // emitValueChanged) and it has also emitted subscribeFinished().
-    screenBlanked.waitForSubscription(true);
+    // The display state is not waited for: until MCE answers, it is
+    // treated as not blanked, and a change is emitted when it does.
     emitValueChanged();
 }
 
 /// Check the current status of the Session.State property and emit
-/// the valueChanged signal.
+/// the valueChanged signal if it differs from the one emitted last.
 void SessionStatePlugin::emitValueChanged()
 {
-    QVariant blanked = screenBlanked.value();
-    if (!blanked.isNull() && blanked.toBool()) {
-        emit valueChanged(sessionStateKey, "blanked");
-    }
+    QString state;
+    if (mce.isDisplayOff())
+        state = "blanked";
     // Either the screen is not blanked or we don't know
-    else if (fullscreen) {
-        emit valueChanged(sessionStateKey, "fullscreen");
-    }
-    else {
-        emit valueChanged(sessionStateKey, "normal");
-    }
-}
+    else if (fullscreen)
+        state = "fullscreen";
+    else
+        state = "normal";
 
-/// Ignore X events which have already arrived. This is to prevent
-/// checking the fullscreen status multiple times when there are
-/// multiple events in the event queue. Also, when the session state
-/// property is unsubscribed, the event queue is cleared, so that the
-/// events don't get processed if the property is re-subscribed.
-void SessionStatePlugin::cleanXEventQueue()
-{
-    int numEvents = XEventsQueued(dpy, QueuedAfterReading);
-    XEvent event;
-    for (int i=0; i<numEvents; ++i) {
-        XNextEvent(dpy, &event);
-    }
+    if (state == emittedState)
+        return;
+    emittedState = state;
+    emit valueChanged(sessionStateKey, state);
 }
 
 } // end namespace
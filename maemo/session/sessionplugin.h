@@ -24,14 +24,13 @@
 
 #include <iproviderplugin.h> // For IProviderPlugin definition
 
-#include <contextproperty.h>
+#include "mceclient.h"
 #include <QThread>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
 
-// Note: Including X11 headers needs to be done after including Qt
-// headers: Qt has an enum CursorShape and Xlib #defines CursorShape to 0.
-#include <X11/Xatom.h>
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
+#include <xcb/xcb.h>
 
 using ContextSubscriber::IProviderPlugin;
 
@@ -50,7 +49,9 @@ namespace ContextSubscriberSessionState
   \brief A libcontextsubscriber plugin for providing the Session.State context property.
 
   SessionStatePlugin reads the full-screen status from window manager
-  via the X protocol. It also listens to the screen blanking signal.
+  via the X protocol (XCB, so that the requests about the top windows
+  can be pipelined). It also listens to the display state signal of
+  MCE directly.
 
  */
 
@@ -69,24 +70,57 @@ public:
 private slots:
     void emitValueChanged();
     void onXEvent();
+    void recompute();
 
 private:
+    /// What we know about a window on the stack, kept current by
+    /// events from the window
+    struct WindowInfo
+    {
+        WindowInfo() : valid(false), viewable(false), sized(false),
+                       interesting(false), fullscreen(false) {}
+        bool valid; ///< Whether the rest is known; false if it must be queried
+        bool viewable; ///< InputOutput class and viewable
+        bool sized; ///< Non-zero width and height
+        bool interesting; ///< Not a desktop or notification window
+        bool fullscreen; ///< Has the fullscreen state
+    };
+
     void checkFullScreen();
-    void cleanXEventQueue();
+    void updateStacking();
+    void updateFullScreen();
+    void queryWindows(const QVector<xcb_window_t>& wins);
+    void selectWindowEvents(xcb_window_t win, bool on);
+    bool invalidateWindow(xcb_window_t win);
+    void clearWindows();
+    void drainXEvents();
+    void handleXEvent(xcb_generic_event_t* event);
+    xcb_atom_t internAtom(xcb_intern_atom_cookie_t cookie);
+    bool isInterestingType(xcb_get_property_reply_t* reply) const;
+    bool isFullScreenState(xcb_get_property_reply_t* reply) const;
 
     QString sessionStateKey; ///< Key of the fullscreen context property
     QSocketNotifier* xNotifier; ///< For listening to the file descriptor used for communicating with X
     bool fullscreen; ///< Whether we're currently in the fullscreen mode
-
-    ::Display* dpy; ///< Pointer to the X display the plugin opens and uses
-    ::Atom clientListStackingAtom; ///< X atom for querying the stacking client list
-    ::Atom windowTypeAtom; ///< X atom for querying the window type
-    ::Atom windowTypeDesktopAtom; ///< X atom for the desktop window type
-    ::Atom windowTypeNotificationAtom; ///< X atom for the notification window type
-    ::Atom stateAtom; ///< X atom for querying the window state
-    ::Atom fullScreenAtom; ///< X atom for the fullscreen window state
-
-    ContextProperty screenBlanked; ///< Context property for listening to the screen blanking status
+    bool subscribed; ///< Whether Session.State is subscribed
+    QString emittedState; ///< The value of Session.State emitted last
+    QTimer recomputeTimer; ///< Collects X events for one recompute()
+    bool stackingChanged; ///< The stacking list changed since the last recompute()
+    bool windowChanged; ///< A tracked window changed since the last recompute()
+
+    xcb_connection_t* xcb; ///< The X connection the plugin opens and uses
+    xcb_window_t root; ///< Root window of the default screen
+    xcb_atom_t clientListStackingAtom; ///< X atom for querying the stacking client list
+    xcb_atom_t windowTypeAtom; ///< X atom for querying the window type
+    xcb_atom_t windowTypeDesktopAtom; ///< X atom for the desktop window type
+    xcb_atom_t windowTypeNotificationAtom; ///< X atom for the notification window type
+    xcb_atom_t stateAtom; ///< X atom for querying the window state
+    xcb_atom_t fullScreenAtom; ///< X atom for the fullscreen window state
+
+    QVector<xcb_window_t> stack; ///< Last known stacking list, bottom first
+    QHash<xcb_window_t, WindowInfo> windows; ///< Windows queried and listened to
+
+    MceClient mce; ///< For listening to the display state
 };
 }
 
@@ -24,26 +24,18 @@ IProviderPlugin* pluginFactory(const QString& constructionString)
 }
 
 BluetoothProvider::BluetoothProvider()
+  : m_bluetoothDevices(0)
 {
   qDebug() << "BluetoothProvider::BluetoothProvider()";
 
-  QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
-
-  m_bluetoothDevices = new BluetoothDevicesModel(this);
-
-  connect(m_bluetoothDevices, SIGNAL(connectedChanged(bool)),
-      this, SLOT(connectedChanged(bool)));
-  connect(m_bluetoothDevices, SIGNAL(discoverableChanged(bool)),
-      this, SLOT(discoverableChanged(bool)));
-  connect(m_bluetoothDevices, SIGNAL(poweredChanged(bool)),
-      this, SLOT(poweredChanged(bool)));
-
   //sadly, QVariant is not a registered metatype
   qRegisterMetaType<QVariant>("QVariant");
 
-  connectedChanged(m_bluetoothDevices->connected());
-  poweredChanged(m_bluetoothDevices->powered());
-  discoverableChanged(m_bluetoothDevices->discoverable());
+  m_lingerTimer.setSingleShot(true);
+  m_lingerTimer.setInterval(lingerTimeout);
+  connect(&m_lingerTimer, SIGNAL(timeout()), this, SLOT(onLingerTimeout()));
+
+  QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
 BluetoothProvider::~BluetoothProvider()
@@ -56,9 +48,14 @@ void BluetoothProvider::subscribe(QSet<QString> keys)
   qDebug() << "BluetoothProvider::subscribe(" << QStringList(keys.toList()).join(", ") << ")";
 
   m_subscribedProperties.unite(keys);
+  m_pendingSubscriptions.unite(keys);
+
+  // a lingering model is still up to date, just keep using it
+  m_lingerTimer.stop();
+  if (!m_bluetoothDevices)
+    createModel();
 
   QMetaObject::invokeMethod(this, "emitSubscribeFinished", Qt::QueuedConnection);
-  QMetaObject::invokeMethod(this, "emitChanged", Qt::QueuedConnection);
 }
 
 void BluetoothProvider::unsubscribe(QSet<QString> keys)
@@ -66,33 +63,70 @@ void BluetoothProvider::unsubscribe(QSet<QString> keys)
   qDebug() << "BluetoothProvider::unsubscribe(" << QStringList(keys.toList()).join(", ") << ")";
 
   m_subscribedProperties.subtract(keys);
+  m_pendingSubscriptions.subtract(keys);
+
+  if (m_subscribedProperties.isEmpty() && m_bluetoothDevices)
+    m_lingerTimer.start();
+}
+
+void BluetoothProvider::createModel()
+{
+  m_bluetoothDevices = new BluetoothDevicesModel(this);
+
+  connect(m_bluetoothDevices, SIGNAL(connectedChanged(bool)),
+      this, SLOT(connectedChanged(bool)));
+  connect(m_bluetoothDevices, SIGNAL(discoverableChanged(bool)),
+      this, SLOT(discoverableChanged(bool)));
+  connect(m_bluetoothDevices, SIGNAL(poweredChanged(bool)),
+      this, SLOT(poweredChanged(bool)));
+
+  // the initial values go out with the queued subscribeFinished
+  m_properties[ckit::is_connected] = m_bluetoothDevices->connected();
+  m_properties[ckit::is_enabled] = m_bluetoothDevices->powered();
+  m_properties[ckit::is_visible] = m_bluetoothDevices->discoverable();
 }
 
+void BluetoothProvider::onLingerTimeout()
+{
+  qDebug() << "BluetoothProvider: nobody subscribed for" << lingerTimeout
+           << "ms, dropping the device model";
+
+  delete m_bluetoothDevices;
+  m_bluetoothDevices = 0;
+  m_properties.clear();
+}
 
 void BluetoothProvider::emitSubscribeFinished()
 {
-  foreach (QString key, m_subscribedProperties) {
-    emit subscribeFinished(key);
+  foreach (QString key, m_pendingSubscriptions) {
+    emit subscribeFinished(key, m_properties.value(key));
   }
+  m_pendingSubscriptions.clear();
 }
 
-void BluetoothProvider::updateProps()
+void BluetoothProvider::setValue(const QString &key, bool value)
 {
-  m_properties[ckit::is_enabled] = m_bluetoothDevices->powered();
-  m_properties[ckit::is_visible] = m_bluetoothDevices->discoverable();
+  QVariantMap::const_iterator it = m_properties.constFind(key);
+  if (it != m_properties.constEnd() && it->toBool() == value)
+    return;
+
+  m_properties[key] = value;
+  // keys still waiting for subscribeFinished get the latest value with it
+  if (m_subscribedProperties.contains(key) && !m_pendingSubscriptions.contains(key))
+    emit valueChanged(key, value);
 }
 
 void BluetoothProvider::connectedChanged(bool value)
 {
-  emit valueChanged(ckit::is_connected, value);
+  setValue(ckit::is_connected, value);
 }
 
 void BluetoothProvider::discoverableChanged(bool value)
 {
-  emit valueChanged(ckit::is_visible, value);
+  setValue(ckit::is_visible, value);
 }
 
 void BluetoothProvider::poweredChanged(bool value)
 {
-  emit valueChanged(ckit::is_enabled, value);
+  setValue(ckit::is_enabled, value);
 }
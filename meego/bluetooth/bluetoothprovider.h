@@ -17,6 +17,7 @@
 #include <QSet>
 #include <QMap>
 #include <QString>
+#include <QTimer>
 #include <QVariant>
 
 
@@ -27,6 +28,11 @@ extern "C"
   IProviderPlugin* pluginFactory(const QString& constructionString);
 }
 
+/*
+ * The device model, and the D-Bus traffic which comes with it, exists
+ * only while somebody is subscribed, plus a linger period after the
+ * last unsubscribe so that quick resubscriptions don't rebuild it.
+ */
 class BluetoothProvider : public IProviderPlugin
 {
   Q_OBJECT;
@@ -42,14 +48,21 @@ public:
 
 private:
 
-  void updateProps();
+  // how long the model is kept after the last unsubscribe
+  static const int lingerTimeout = 10000;
+
+  void createModel();
+  void setValue(const QString &key, bool value);
 
   QSet<QString> m_subscribedProperties;
+  QSet<QString> m_pendingSubscriptions;
   QVariantMap m_properties;
   BluetoothDevicesModel *m_bluetoothDevices;
+  QTimer m_lingerTimer;
 
 private slots:
   void emitSubscribeFinished();
+  void onLingerTimeout();
   void connectedChanged(bool);
   void discoverableChanged(bool);
   void poweredChanged(bool);
@@ -23,13 +23,11 @@
 
 #include <contextkit_props/internal_keyboard.hpp>
 #include <cor/udev.hpp>
+#include <cor/evdev.hpp>
 #include "plugin.hpp"
 
-#include <linux/input.h>
-
+#include <QSocketNotifier>
 #include <QString>
-#include <QStringList>
-#include <QVector>
 
 
 IProviderPlugin* pluginFactory(const QString&)
@@ -44,57 +42,13 @@ namespace ckit = contextkit::internal_keyboard;
 
 static bool isKeyboardDevice(cor::udev::Device const &dev)
 {
-    QString key(dev.attr("capabilities/key"));
-    QStringList caps_strs(key.split(' ', QString::SkipEmptyParts));
-    if (caps_strs.isEmpty())
-        return false;
-    QVector<unsigned long> caps;
-    foreach(QString const &s, caps_strs) {
-        unsigned long v;
-        bool is_ok = false;
-        v = s.toULong(&is_ok, 16);
-        if (!is_ok)
-            return false;
-        caps.push_back(v);
-    }
-    size_t count = 0;
-    for (unsigned i = KEY_Q; i <= KEY_P; ++i) {
-        int pos = caps.size() - (i / sizeof(unsigned long));
-        if (pos < 0)
-            break;
-        size_t bit = i % sizeof(unsigned long);
-        if ((caps[pos] >> bit) & 1)
-            ++count;
-    }
-    return (count == KEY_P - KEY_Q);
-}
-
-static bool isKeyboardAvailable()
-{
-    using namespace cor::udev;
-    Root udev;
-    if (!udev)
-        return false;
-
-    Enumerate input(udev);
-    if (!input)
-        return false;
-
-    input.subsystem_add("input");
-    ListEntry devs(input);
-
-    bool is_kbd_found = false;
-    auto find_kbd = [&is_kbd_found, &udev](ListEntry const &e) -> bool {
-        Device d(udev, e.path());
-        is_kbd_found = isKeyboardDevice(d);
-        return !is_kbd_found;
-    };
-    devs.for_each(find_kbd);
-    return is_kbd_found;
+    cor::evdev::KeyBits keys;
+    return keys.parse(dev.attr("capabilities/key"))
+        && cor::evdev::has_qwerty_row(keys);
 }
 
 KeyboardGeneric::KeyboardGeneric()
-    : is_setup(false), is_kbd_available(false)
+    : notifier(0), is_setup(false), is_kbd_available(false)
 {
     props[ckit::is_present] = [&]() {
         emitChanged(ckit::is_present, is_kbd_available);
@@ -105,12 +59,97 @@ KeyboardGeneric::KeyboardGeneric()
     QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
+KeyboardGeneric::~KeyboardGeneric()
+{
+    delete notifier;
+}
+
+/// Starts listening to input device hotplug and enumerates the devices
+/// present. The monitor is enabled first, so nothing plugged in
+/// meanwhile gets lost; after that the set of keyboards is only
+/// maintained from the events.
 void KeyboardGeneric::setup()
 {
-    if (!is_setup) {
-        is_kbd_available = isKeyboardAvailable();
-        is_setup = true;
+    using namespace cor::udev;
+    if (is_setup)
+        return;
+    is_setup = true;
+
+    udev.reset(new Root());
+    if (!*udev)
+        return;
+
+    monitor.reset(new Monitor(*udev));
+    if (*monitor && monitor->subsystem_add("input") && monitor->enable()) {
+        notifier = new QSocketNotifier(monitor->fd(), QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), this, SLOT(onUdevEvent()));
+    } else {
+        monitor.reset();
+    }
+
+    Enumerate input(*udev);
+    if (!input)
+        return;
+
+    // only input devices with key capabilities, not their event nodes
+    input.subsystem_add("input");
+    input.sysattr_add("capabilities/key");
+
+    Root &root = *udev;
+    auto add_kbd = [this, &root](ListEntry const &e) -> bool {
+        Device d(root, e.path());
+        if (isKeyboardDevice(d))
+            keyboards.insert(QString(d.path()));
+        return true;
+    };
+    input.devices().for_each(add_kbd);
+    is_kbd_available = !keyboards.isEmpty();
+}
+
+/// Stops listening to hotplug when nothing is subscribed. The set of
+/// keyboards would go stale, so setup() enumerates them again.
+void KeyboardGeneric::teardown()
+{
+    if (!is_setup)
+        return;
+    is_setup = false;
+
+    delete notifier;
+    notifier = 0;
+    monitor.reset();
+    udev.reset();
+    keyboards.clear();
+}
+
+void KeyboardGeneric::onUdevEvent()
+{
+    // the monitor socket is non-blocking, drain all pending events
+    while (true) {
+        cor::udev::Device d(*monitor);
+        if (!d)
+            break;
+
+        QString path(d.path());
+        QString action(d.action());
+        if (action == "remove")
+            keyboards.remove(path);
+        else if (isKeyboardDevice(d))
+            keyboards.insert(path);
+        else
+            keyboards.remove(path);
     }
+    updateAvailable();
+}
+
+void KeyboardGeneric::updateAvailable()
+{
+    bool is_available = !keyboards.isEmpty();
+    if (is_available == is_kbd_available)
+        return;
+
+    is_kbd_available = is_available;
+    foreach(QString const &k, subscribed)
+        props[k]();
 }
 
 void KeyboardGeneric::emitChanged(QString const &name, QVariant const &value)
@@ -123,14 +162,19 @@ void KeyboardGeneric::subscribe(QSet<QString> keys)
 {
     setup();
     foreach(QString const &k, keys) {
-        if (props.contains(k))
+        if (props.contains(k)) {
+            subscribed.insert(k);
             props[k]();
+        }
     }
 }
 
 /// Implementation of the IPropertyProvider::unsubscribe.
-void KeyboardGeneric::unsubscribe(QSet<QString>)
+void KeyboardGeneric::unsubscribe(QSet<QString> keys)
 {
+    subscribed.subtract(keys);
+    if (subscribed.isEmpty())
+        teardown();
 }
 
 void KeyboardGeneric::blockUntilReady()
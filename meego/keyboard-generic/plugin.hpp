@@ -26,10 +26,19 @@
 #include <iproviderplugin.h>
 
 #include <functional>
+#include <memory>
 
 #include <QObject>
 #include <QMap>
 #include <QSet>
+#include <QString>
+
+class QSocketNotifier;
+
+namespace cor { namespace udev {
+class Root;
+class Monitor;
+}}
 
 using ContextSubscriber::IProviderPlugin;
 
@@ -45,18 +54,30 @@ class KeyboardGeneric : public IProviderPlugin
     Q_OBJECT;
 public:
     KeyboardGeneric();
-    virtual ~KeyboardGeneric() {}
+    virtual ~KeyboardGeneric();
 
     virtual void subscribe(QSet<QString>);
     virtual void unsubscribe(QSet<QString>);
     virtual void blockUntilReady();
     virtual void blockUntilSubscribed(const QString&);
 
+private slots:
+    void onUdevEvent();
+
 private:
     void setup();
+    void teardown();
+    void updateAvailable();
     void emitChanged(QString const &, QVariant const &);
 
     QMap<QString, std::function<void ()> > props;
+    QSet<QString> subscribed;
+
+    std::unique_ptr<cor::udev::Root> udev;
+    std::unique_ptr<cor::udev::Monitor> monitor;
+    QSocketNotifier *notifier;
+    // syspaths of the input devices which look like keyboards
+    QSet<QString> keyboards;
 
     bool is_setup;
     bool is_kbd_available;
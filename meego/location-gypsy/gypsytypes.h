@@ -16,6 +16,19 @@ public:
 
 typedef QList<SatInfo> SatInfoArray;
 
+// validity bits of the Position and Course "fields" arguments
+enum {
+	GYPSY_POSITION_FIELDS_LATITUDE = 1 << 0,
+	GYPSY_POSITION_FIELDS_LONGITUDE = 1 << 1,
+	GYPSY_POSITION_FIELDS_ALTITUDE = 1 << 2
+};
+
+enum {
+	GYPSY_COURSE_FIELDS_SPEED = 1 << 0,
+	GYPSY_COURSE_FIELDS_DIRECTION = 1 << 1,
+	GYPSY_COURSE_FIELDS_CLIMB = 1 << 2
+};
+
 Q_DECLARE_METATYPE(SatInfoArray)
 
 #endif // GYPSYTYPES_H
@@ -13,6 +13,7 @@
 #include "gypsy_interface.h"
 
 #include <QDBusConnection>
+#include <QDBusMessage>
 #include <QDBusObjectPath>
 #include <QDBusPendingCallWatcher>
 #include <MGConfItem>
@@ -23,6 +24,8 @@ namespace ckit = contextkit::location;
 
 
 const QString LocationProvider::gypsyService("org.freedesktop.Gypsy");
+const QString LocationProvider::gypsyServerPath("/org/freedesktop/Gypsy");
+const QString LocationProvider::gypsyServerInterface("org.freedesktop.Gypsy.Server");
 
 IProviderPlugin* pluginFactory(const QString& constructionString)
 {
@@ -31,13 +34,29 @@ IProviderPlugin* pluginFactory(const QString& constructionString)
 }
 
 LocationProvider::LocationProvider() :
-  gpsDevice(NULL), position(NULL), course(NULL)
+  gypsyPath(NULL), createWatcher(NULL),
+  gpsDevice(NULL), position(NULL), course(NULL),
+  isConnected(false), fixStatus(0)
 {
 	qDebug() << "LocationProvider " << "Initializing LocationProvider provider";
 
+	lingerTimer.setSingleShot(true);
+	lingerTimer.setInterval(lingerTimeout);
+	connect(&lingerTimer, SIGNAL(timeout()), this, SLOT(onLingerTimeout()));
+
 	QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
+LocationProvider::~LocationProvider()
+{
+	// never block here: a Create() still in flight is dropped, and
+	// the device it makes is left to gypsy to clean up along with
+	// our bus connection; Shutdown is sent without waiting
+	delete createWatcher;
+	createWatcher = NULL;
+	closeDevice();
+}
+
 void LocationProvider::subscribe(QSet<QString> keys)
 {
 	qDebug() << "LocationProvider " << "subscribed to LocationProvider provider";
@@ -45,12 +64,20 @@ void LocationProvider::subscribe(QSet<QString> keys)
 	if(!subscribedProps.count()) onFirstSubscriberAppeared();
 
 	subscribedProps.unite(keys);
-
-	if (subscribedProps.contains(ckit::coord)) {
-	  getCoordinates();
-	}
-	if (subscribedProps.contains(ckit::heading)) {
-	  getHeading();
+	pendingSubscriptions.unite(keys);
+
+	// newly subscribed keys should get the current value at once
+	if (keys.contains(ckit::coord))
+		filter.resetPosition();
+	if (keys.contains(ckit::heading))
+		filter.resetHeading();
+
+	// device is not created yet, createFinished() will fetch values
+	if (gpsDevice) {
+		if (keys.contains(ckit::coord))
+			getCoordinates();
+		if (keys.contains(ckit::heading))
+			getHeading();
 	}
 
 	QMetaObject::invokeMethod(this, "emitSubscribeFinished", Qt::QueuedConnection);
@@ -59,96 +86,186 @@ void LocationProvider::subscribe(QSet<QString> keys)
 void LocationProvider::unsubscribe(QSet<QString> keys)
 {
 	subscribedProps.subtract(keys);
+	pendingSubscriptions.subtract(keys);
 	if(!subscribedProps.count()) onLastSubscriberDisappeared();
 }
 
 void LocationProvider::onFirstSubscriberAppeared()
 {
-	qDebug("first subscriber appeared!");
 	qDebug() << "LocationProvider " << "First subscriber appeared, connecting to Gypsy";
 
-	MGConfItem *gypsyPath = new MGConfItem("/apps/geoclue/master/org.freedesktop.Geoclue.GPSDevice", this);
-	if (!gypsyPath || gypsyPath->value() == QVariant::Invalid) {
-	  QString errorString("Gypsy path is invalid or missing from gconf!");
-	  qDebug()  << "LocationProvider " << errorString;
-	  QMetaObject::invokeMethod(this, "failed", Qt::QueuedConnection,
-				    Q_ARG(QString, errorString));
-	  return;
+	if (lingerTimer.isActive()) {
+		// device is still open, just keep using it
+		lingerTimer.stop();
+		return;
+	}
+
+	if (!gpsDevice && !createWatcher) {
+		filter.load();
+		createDevice();
 	}
-	qDebug() << "using" << gypsyPath->value().toString() << "as gypsy path";
-
-	QDBusInterface *interface = new QDBusInterface(gypsyService, "/org/freedesktop/Gypsy",
-						       "org.freedesktop.Gypsy.Server", QDBusConnection::systemBus(), this);
-	QDBusReply<QDBusObjectPath> reply = interface->call("Create", gypsyPath->value().toString());
-	  if (!reply.isValid()) {
-	    QDBusError error = reply.error();
-	    QString errorString(error.errorString(error.type()) + ": " + error.message());
-	    qDebug() << "creating gypsy device resulted in error:" << errorString;
-	    QMetaObject::invokeMethod(this, "failed", Qt::QueuedConnection,
-				      Q_ARG(QString, errorString));
-	    return; 
-	  }
-	QString devicePath = reply.value().path();
+}
+
+void LocationProvider::onLastSubscriberDisappeared()
+{
+	qDebug() << "LocationProvider" << "Last subscriber gone, closing Gypsy device in"
+		 << lingerTimeout << "ms";
+	lingerTimer.start();
+}
+
+void LocationProvider::onLingerTimeout()
+{
+	// if Create() is still in flight createFinished() closes the device
+	if (!createWatcher)
+		closeDevice();
+}
+
+void LocationProvider::createDevice()
+{
+	if (!gypsyPath)
+		gypsyPath = new MGConfItem("/apps/geoclue/master/org.freedesktop.Geoclue.GPSDevice", this);
+
+	QVariant path = gypsyPath->value();
+	if (path == QVariant::Invalid) {
+		QString errorString("Gypsy path is invalid or missing from gconf!");
+		qDebug()  << "LocationProvider " << errorString;
+		QMetaObject::invokeMethod(this, "failed", Qt::QueuedConnection,
+					  Q_ARG(QString, errorString));
+		return;
+	}
+	qDebug() << "using" << path.toString() << "as gypsy path";
+
+	// plain message instead of QDBusInterface to avoid introspection
+	QDBusMessage msg = QDBusMessage::createMethodCall
+		(gypsyService, gypsyServerPath, gypsyServerInterface, "Create");
+	msg << path.toString();
+	QDBusPendingCall call = QDBusConnection::systemBus().asyncCall(msg);
+	createWatcher = new QDBusPendingCallWatcher(call, this);
+	connect(createWatcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+		this, SLOT(createFinished(QDBusPendingCallWatcher*)));
+}
+
+void LocationProvider::createFinished(QDBusPendingCallWatcher *watcher)
+{
+	createWatcher = NULL;
+	watcher->deleteLater();
+
+	QDBusPendingReply<QDBusObjectPath> reply = *watcher;
+	if (reply.isError()) {
+		QDBusError error = reply.error();
+		QString errorString(error.errorString(error.type()) + ": " + error.message());
+		qDebug() << "creating gypsy device resulted in error:" << errorString;
+		if (subscribedProps.count())
+			QMetaObject::invokeMethod(this, "failed", Qt::QueuedConnection,
+						  Q_ARG(QString, errorString));
+		return;
+	}
+	devicePath = reply.value().path();
 	qDebug()<<"device path: "<<devicePath;
-	
-	gpsDevice = new OrgFreedesktopGypsyDeviceInterface(gypsyService, devicePath,
-							   QDBusConnection::systemBus(), this);
-	position = new OrgFreedesktopGypsyPositionInterface(gypsyService, devicePath, QDBusConnection::systemBus(), this);
-	
+
+	if (!subscribedProps.count() && !lingerTimer.isActive()) {
+		// everybody left and the linger period is already over
+		closeDevice();
+		return;
+	}
+
+	QDBusConnection bus(QDBusConnection::systemBus());
+	gpsDevice = new OrgFreedesktopGypsyDeviceInterface(gypsyService, devicePath, bus, this);
+	position = new OrgFreedesktopGypsyPositionInterface(gypsyService, devicePath, bus, this);
+	course = new OrgFreedesktopGypsyCourseInterface(gypsyService, devicePath, bus, this);
+
 	connect(gpsDevice,SIGNAL(ConnectionStatusChanged(bool)),this,SLOT(connectionStatusChanged(bool)));
 	connect(gpsDevice,SIGNAL(FixStatusChanged(int)),this, SLOT(fixStatusChanged(int)));
-	
 	connect(position,SIGNAL(PositionChanged(int,int,double,double,double)), this, SLOT(positionChanged(int,int,double,double,double)));
-	  
-	course = new OrgFreedesktopGypsyCourseInterface(gypsyService, devicePath, QDBusConnection::systemBus(), this);
 	connect(course, SIGNAL(CourseChanged(int,int,double,double,double)),
 		this, SLOT(courseChanged(int,int,double,double,double)));
 
-	QMetaObject::invokeMethod(this, "updateProperties", Qt::QueuedConnection);
+	updateProperties();
+	if (subscribedProps.contains(ckit::coord))
+		getCoordinates();
+	if (subscribedProps.contains(ckit::heading))
+		getHeading();
 }
 
-void LocationProvider::onLastSubscriberDisappeared()
+void LocationProvider::closeDevice()
 {
-	qDebug() << "LocationProvider" << "Last subscriber gone, destroying LocationProvider connections";
-	//TODO: disconnect from gpysy at this point
+	lingerTimer.stop();
+
+	// deleting the proxies drops their signal match rules
+	delete course;
+	course = NULL;
+	delete position;
+	position = NULL;
+	delete gpsDevice;
+	gpsDevice = NULL;
+
+	if (!devicePath.isEmpty()) {
+		qDebug() << "LocationProvider" << "shutting down gypsy device" << devicePath;
+		QDBusMessage msg = QDBusMessage::createMethodCall
+			(gypsyService, gypsyServerPath, gypsyServerInterface, "Shutdown");
+		msg << QVariant::fromValue(QDBusObjectPath(devicePath));
+		QDBusConnection::systemBus().send(msg);
+		devicePath.clear();
+	}
+
+	isConnected = false;
+	fixStatus = 0;
+	filter.reset();
+	sample = LocationSample();
+	satPosState.clear();
 }
 
 void LocationProvider::updateProperties()
 {
-	///TODO: update all properties
-
-	if(!gpsDevice || !gpsDevice->isValid())
+	if(!gpsDevice)
 	{
-		qDebug("gpsDevice is not valid");
+		qDebug("gpsDevice is not created");
 		return;
 	}
-	bool isConnected = gpsDevice->GetConnectionStatus();
-	int fixStatus = gpsDevice->GetFixStatus();
 
+	QDBusPendingCallWatcher *watcher;
+	watcher = new QDBusPendingCallWatcher(gpsDevice->GetConnectionStatus(), this);
+	connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+		this, SLOT(getConnectionStatusFinished(QDBusPendingCallWatcher*)));
+	watcher = new QDBusPendingCallWatcher(gpsDevice->GetFixStatus(), this);
+	connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+		this, SLOT(getFixStatusFinished(QDBusPendingCallWatcher*)));
+}
+
+void LocationProvider::updateSatPosState()
+{
 	qDebug()<<" connected? "<<isConnected<<" fix status: "<<fixStatus;
 
+	QString state;
 	if(!isConnected)
-		Properties[ckit::sat_pos_state] = "off";
+		state = "off";
 	else
-		Properties[ckit::sat_pos_state] = fixStatus == 1 ? "searching":"on";
+		state = fixStatus == 1 ? "searching":"on";
 
-	foreach(QString key, subscribedProps)
-	{
-		emit valueChanged(key, Properties[key]);
-	}
+	if (state == satPosState)
+		return;
+	satPosState = state;
+	if (subscribedProps.contains(ckit::sat_pos_state))
+		emit valueChanged(ckit::sat_pos_state, satPosState);
 }
 
 void LocationProvider::emitSubscribeFinished()
 {
-	foreach(QString key, subscribedProps)
+	foreach(QString key, pendingSubscriptions)
 	{
-		emit subscribeFinished(key);
+		// the state only changes on gypsy signals; if it is already
+		// known, a new subscriber gets it now
+		if (key == ckit::sat_pos_state && !satPosState.isEmpty())
+			emit subscribeFinished(key, satPosState);
+		else
+			emit subscribeFinished(key);
 	}
+	pendingSubscriptions.clear();
 }
 
 void LocationProvider::getCoordinates()
 {
-  if (!position->isValid()) {
+  if (!position) {
     qDebug() << "position interface is invalid!";
     return;
   }
@@ -160,7 +277,7 @@ void LocationProvider::getCoordinates()
 
 void LocationProvider::getHeading()
 {
-  if (!course->isValid()) {
+  if (!course) {
     qDebug() << "course interface is invalid!";
     return;
   }
@@ -170,57 +287,47 @@ void LocationProvider::getHeading()
 	  this, SLOT(getCourseFinished(QDBusPendingCallWatcher*)));
 }
 
-void LocationProvider::updateProperty(const QString& key, const QVariant& value)
-{
-    bool changed = true;
-    if (Properties[key] == value) {
-      changed = false;
-    }
-    
-    Properties[key] = value;
-    if (subscribedProps.contains(key) && changed) {
-      emit valueChanged(key, value);
-    }
-}
-
-void LocationProvider::fixStatusChanged(int)
+void LocationProvider::fixStatusChanged(int status)
 {
-	updateProperties();
+	fixStatus = status;
+	updateSatPosState();
 }
 
 void LocationProvider::positionChanged(int fields, int timestamp, double latitude, double longitude, double altitude)
 {
-    //FIXME: use fields correctly
-    qDebug() << "LocationProvider:" << "New coordinate values:";
-    qDebug() << "\tfields:" << fields << endl
-             << "\ttimestamp:" << timestamp << endl
-             << "\tlatitude:" << latitude << endl
-             << "\tlongitude:" << longitude << endl
-             << "\taltitude:" << altitude;
-
-    QList<QVariant> coords;
-    coords.append(QVariant(latitude));
-    coords.append(QVariant(longitude));
-    coords.append(QVariant(altitude));
-    updateProperty(ckit::coord, coords);
+    unsigned valid = 0;
+    if (fields & GYPSY_POSITION_FIELDS_LATITUDE)
+        valid |= LocationSample::Latitude;
+    if (fields & GYPSY_POSITION_FIELDS_LONGITUDE)
+        valid |= LocationSample::Longitude;
+    if (fields & GYPSY_POSITION_FIELDS_ALTITUDE)
+        valid |= LocationSample::Altitude;
+    sample.setPosition(valid, timestamp, latitude, longitude, altitude);
+
+    if (subscribedProps.contains(ckit::coord) && filter.acceptPosition(sample))
+        emit valueChanged(ckit::coord, sample.coordinates());
 }
 
 void LocationProvider::courseChanged(int fields, int timestamp, double speed, double direction, double climb)
 {
-    //FIXME: use fields correctly
-    qDebug() << "LocationProvider:" << "New course values:";
-    qDebug() << "\tfields:" << fields << endl
-	     << "\ttimestamp:" << timestamp << endl
-	     << "\tspeed:" << speed << endl
-	     << "\tdirection:" << direction << endl
-	     << "\tclimb:" << climb << endl;
-    updateProperty(ckit::heading, direction);
+    unsigned valid = 0;
+    if (fields & GYPSY_COURSE_FIELDS_SPEED)
+        valid |= LocationSample::Speed;
+    if (fields & GYPSY_COURSE_FIELDS_DIRECTION)
+        valid |= LocationSample::Direction;
+    if (fields & GYPSY_COURSE_FIELDS_CLIMB)
+        valid |= LocationSample::Climb;
+    sample.setCourse(valid, timestamp, speed, direction, climb);
+
+    if (subscribedProps.contains(ckit::heading) && filter.acceptHeading(sample))
+        emit valueChanged(ckit::heading, sample.heading());
 }
 
 
-void LocationProvider::connectionStatusChanged(bool)
+void LocationProvider::connectionStatusChanged(bool connected)
 {
-	updateProperties();
+	isConnected = connected;
+	updateSatPosState();
 }
 
 void LocationProvider::getPositionFinished(QDBusPendingCallWatcher *watcher)
@@ -252,3 +359,25 @@ void LocationProvider::getCourseFinished(QDBusPendingCallWatcher* watcher)
   }
   watcher->deleteLater();
 }
+
+void LocationProvider::getConnectionStatusFinished(QDBusPendingCallWatcher* watcher)
+{
+  QDBusPendingReply<bool> reply = *watcher;
+  if (reply.isError()) {
+    qDebug() << "GetConnectionStatus resulted in error!";
+  } else {
+    connectionStatusChanged(reply.value());
+  }
+  watcher->deleteLater();
+}
+
+void LocationProvider::getFixStatusFinished(QDBusPendingCallWatcher* watcher)
+{
+  QDBusPendingReply<int> reply = *watcher;
+  if (reply.isError()) {
+    qDebug() << "GetFixStatus resulted in error!";
+  } else {
+    fixStatusChanged(reply.value());
+  }
+  watcher->deleteLater();
+}
@@ -15,11 +15,14 @@
 #include <QVariant>
 #include <QStringList>
 #include <QObject>
+#include <QTimer>
 #include <iproviderplugin.h>
 #include <contextproperty.h>
+#include <contextkit_location.hpp>
 #include "gypsy_interface.h"
 
 class QDBusPendingCallWatcher;
+class MGConfItem;
 
 using ContextSubscriber::IProviderPlugin;
 
@@ -34,7 +37,7 @@ class LocationProvider : public IProviderPlugin
 
 public:
     LocationProvider();
-    virtual ~LocationProvider() {}
+    virtual ~LocationProvider();
 
     virtual void subscribe(QSet<QString> keys);
     virtual void unsubscribe(QSet<QString> keys);
@@ -44,29 +47,48 @@ public:
 private:
 
     static const QString gypsyService;
+    static const QString gypsyServerPath;
+    static const QString gypsyServerInterface;
+    // how long the device is kept open after the last unsubscribe
+    static const int lingerTimeout = 10000;
 
-    QHash<QString,QVariant> Properties;
     QSet<QString> subscribedProps;
+    QSet<QString> pendingSubscriptions; // waiting for emitSubscribeFinished()
+    MGConfItem *gypsyPath;
+    QString devicePath;
+    QDBusPendingCallWatcher *createWatcher;
+    QTimer lingerTimer;
     OrgFreedesktopGypsyDeviceInterface *gpsDevice;
     OrgFreedesktopGypsyPositionInterface *position;
     OrgFreedesktopGypsyCourseInterface *course;
-    
-    void updateProperty(const QString& key, const QVariant& value);
+    bool isConnected;
+    int fixStatus;
+    LocationSample sample;
+    LocationFilter filter;
+    QString satPosState;
+
     void getCoordinates();
     void getHeading();
+    void createDevice();
+    void closeDevice();
 
 private slots:
     void updateProperties();
+    void updateSatPosState();
     void emitSubscribeFinished();
     void onFirstSubscriberAppeared();
     void onLastSubscriberDisappeared();
+    void onLingerTimeout();
+    void createFinished(QDBusPendingCallWatcher* watcher);
 
     void fixStatusChanged(int);
     void positionChanged(int fields, int timestamp, double latitude, double longitude, double altitude);
-  void courseChanged(int fields, int timestamp, double speed, double direction, double climb);
+    void courseChanged(int fields, int timestamp, double speed, double direction, double climb);
     void connectionStatusChanged(bool);
     void getPositionFinished(QDBusPendingCallWatcher* watcher);
     void getCourseFinished(QDBusPendingCallWatcher* watcher);
+    void getConnectionStatusFinished(QDBusPendingCallWatcher* watcher);
+    void getFixStatusFinished(QDBusPendingCallWatcher* watcher);
 };
 
 
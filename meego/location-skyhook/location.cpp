@@ -18,8 +18,10 @@
 #include <MGConfItem>
 
 #include <contextkit_props/location.hpp>
+#include <contextkit_props/satellites.hpp>
 
 namespace ckit = contextkit::location;
+namespace sat = contextkit::satellites;
 
 IProviderPlugin* pluginFactory(const QString& constructionString)
 {
@@ -31,6 +33,12 @@ LocationProvider::LocationProvider() :
   gpsDevice(NULL)
 {
 	qDebug() << "LocationProvider " << "Initializing LocationProvider provider";
+	receiverTimer.setSingleShot(true);
+	receiverTimer.setInterval(receiverTimeout);
+	connect(&receiverTimer, SIGNAL(timeout()), this, SLOT(receiverStopped()));
+	fixHoldTimer.setSingleShot(true);
+	fixHoldTimer.setInterval(fixHoldTime);
+	connect(&fixHoldTimer, SIGNAL(timeout()), this, SLOT(fixLost()));
 	QMetaObject::invokeMethod(this, "ready", Qt::QueuedConnection);
 }
 
@@ -47,6 +55,12 @@ void LocationProvider::subscribe(QSet<QString> keys)
 
 	subscribedProps.unite(keys);
 
+	// newly subscribed keys should get the next fix unfiltered
+	if (keys.contains(ckit::coord))
+		filter.resetPosition();
+	if (keys.contains(ckit::heading))
+		filter.resetHeading();
+
         QMetaObject::invokeMethod(this, "emitSubscribeFinished", Qt::QueuedConnection);
 }
 
@@ -62,6 +76,8 @@ void LocationProvider::onFirstSubscriberAppeared()
 	qDebug("first subscriber appeared!");
         qDebug() << "LocationProvider " << "First subscriber appeared, connecting to Skyhook";
 
+        filter.load();
+
         gpsDevice = new LocationSkyHook("com.skyhookwireless.wps.Daemon", "/com/skyhookwireless/wps/Daemon", QDBusConnection::sessionBus(), this);
         if(!gpsDevice->isValid())
         {
@@ -73,6 +89,8 @@ void LocationProvider::onFirstSubscriberAppeared()
                 this, SLOT(locationChanged(double, double, double, double, double, double, double)));
         connect(gpsDevice, SIGNAL(Satellites(QList<int>, QList<int>, QList<int>, QList<int>, QList<bool>)),
                 this, SLOT(satellitesChanged(QList<int>, QList<int>, QList<int>, QList<int>, QList<bool>)));
+        // off until the receiver shows signs of life
+        receiverTimer.start();
 
         QMetaObject::invokeMethod(this, "updateProperties", Qt::QueuedConnection);
 }
@@ -80,6 +98,10 @@ void LocationProvider::onFirstSubscriberAppeared()
 void LocationProvider::onLastSubscriberDisappeared()
 {
 	qDebug() << "LocationProvider" << "Last subscriber gone, destroying LocationProvider connections";
+        satPosState.clear();
+        summary = SatelliteSummary();
+        receiverTimer.stop();
+        fixHoldTimer.stop();
         //TODO: disconnect from skyhook at this point
 }
 
@@ -91,58 +113,109 @@ void LocationProvider::emitSubscribeFinished()
 	}
 }
 
-void LocationProvider::updateProperty(const QString& key, const QVariant& value)
+void LocationProvider::updateSatPosState(const QString& state)
 {
-    bool changed = true;
-    if (Properties[key] == value) {
-      changed = false;
-    }
+    if (state == satPosState)
+        return;
+    satPosState = state;
+    if (subscribedProps.contains(ckit::sat_pos_state))
+        emit valueChanged(ckit::sat_pos_state, satPosState);
+}
+
+QVariantList SatelliteSummary::histogram() const
+{
+    QVariantList buckets;
+    for (int i = 0; i < snrBuckets; ++i)
+        buckets << snrHistogram[i];
+    return buckets;
+}
 
-    Properties[key] = value;
-    if (subscribedProps.contains(key) && changed) {
-      emit valueChanged(key, value);
+void LocationProvider::updateSummary(const SatelliteSummary& next)
+{
+    SatelliteSummary prev = summary;
+    summary = next;
+
+    if (prev.visible != next.visible && subscribedProps.contains(sat::visible))
+        emit valueChanged(sat::visible, next.visible);
+    if (prev.inUse != next.inUse && subscribedProps.contains(sat::in_use))
+        emit valueChanged(sat::in_use, next.inUse);
+    if (prev.bestSnr != next.bestSnr && subscribedProps.contains(sat::best_snr))
+        emit valueChanged(sat::best_snr, next.bestSnr);
+    if (subscribedProps.contains(sat::snr_histogram)) {
+        QVariantList histogram = next.histogram();
+        if (prev.histogram() != histogram)
+            emit valueChanged(sat::snr_histogram, histogram);
     }
 }
 
+// Skyhook has no receiver state of its own: it sends Satellites about
+// once a second while the receiver runs, even with nothing in view
+void LocationProvider::receiverStopped()
+{
+    fixHoldTimer.stop();
+    updateSummary(SatelliteSummary());
+    updateSatPosState("off");
+}
+
+void LocationProvider::fixLost()
+{
+    updateSatPosState("searching");
+}
 
 void LocationProvider::locationChanged(double latitude, double longitude, double hpe, double altitude, double speed, double bearing, double timestamp)
 {
-    //FIXME: use fields correctly
-    qDebug() << "LocationProvider:" << "New location values:";
-    qDebug() << "\ttimestamp:" << timestamp << endl
-             << "\tlatitude:" << latitude << endl
-             << "\tlongitude:" << longitude << endl
-             << "\taltitude:" << altitude << endl
-             << "\thpe:" << hpe << endl
-             << "\tspeed:" << speed << endl
-             << "\tspeed:" << bearing;
-
-    QList<QVariant> coords;
-    coords.append(QVariant(latitude));
-    coords.append(QVariant(longitude));
-    coords.append(QVariant(altitude));
-    updateProperty(ckit::coord, coords);
-    updateProperty(ckit::heading, bearing);
+    Q_UNUSED(hpe)
+
+    // skyhook always reports complete fixes
+    int time = static_cast<int>(timestamp);
+    sample.setPosition(LocationSample::PositionFields, time,
+                       latitude, longitude, altitude);
+    sample.setCourse(LocationSample::Speed | LocationSample::Direction,
+                     time, speed, bearing, 0);
+
+    if (subscribedProps.contains(ckit::coord) && filter.acceptPosition(sample))
+        emit valueChanged(ckit::coord, sample.coordinates());
+    if (subscribedProps.contains(ckit::heading) && filter.acceptHeading(sample))
+        emit valueChanged(ckit::heading, sample.heading());
 }
 
 void LocationProvider::satellitesChanged(QList<int> prns, QList<int> snrs, QList<int> elevations, QList<int> azimuths, QList<bool> inuse)
 {
-    //FIXME: use fields correctly
-    qDebug() << "LocationProvider:" << "New satellite values:";
-
-    bool satelliteOn = false;
-
-  for(int satellite = 0; satellite < prns.count(); satellite++){
-    qDebug() << "\tprns: " << prns.at(satellite) << endl
-             << "\tsnrs: " << snrs.at(satellite) << endl
-             << "\televations: " << elevations.at(satellite) << endl
-             << "\tazimuths: " << azimuths.at(satellite) << endl
-             << "\tinuse: " << inuse.at(satellite);
-               if(inuse.at(satellite) == true)
-                    satelliteOn = true;
-  }
-
-  QString state = (satelliteOn ? "on" : "off" ); //what is valid for searching?
+    Q_UNUSED(elevations)
+    Q_UNUSED(azimuths)
+
+    receiverTimer.start();
+
+    SatelliteSummary next;
+    int count = qMin(prns.count(), qMin(snrs.count(), inuse.count()));
+    next.visible = count;
+    for (int i = 0; i < count; ++i) {
+        int snr = snrs.at(i);
+        next.snrHistogram[qBound(0, snr / SatelliteSummary::snrBucket,
+                                 SatelliteSummary::snrBuckets - 1)]++;
+        if (inuse.at(i)) {
+            next.inUse++;
+            if (snr > next.bestSnr)
+                next.bestSnr = snr;
+        }
+    }
+    updateSummary(next);
+
+    // a fix has to stay lost for fixHoldTime before "on" is left, so
+    // that a satellite dropping in and out of use does not flap it
+    QString state = "searching";
+    if (next.inUse >= SatelliteSummary::minInUseForFix) {
+        fixHoldTimer.stop();
+        state = "on";
+    } else if (satPosState == "on") {
+        if (!fixHoldTimer.isActive())
+            fixHoldTimer.start();
+        state = "on";
+    }
 
-    updateProperty(ckit::sat_pos_state, state);
+    if (state != satPosState)
+        qDebug() << "LocationProvider:" << state << "satellites visible"
+                 << next.visible << "in use" << next.inUse
+                 << "best snr" << next.bestSnr;
+    updateSatPosState(state);
 }
@@ -13,12 +13,38 @@
 #define LOCATIONPROVIDER_H
 
 #include <QObject>
+#include <QTimer>
+#include <QVariant>
 #include <iproviderplugin.h>
 #include <contextproperty.h>
+#include <contextkit_location.hpp>
 #include "skyhook_interface.h"
 
 using ContextSubscriber::IProviderPlugin;
 
+// what is left of one Satellites signal after reduction
+struct SatelliteSummary
+{
+    // SNR histogram bucket width in dB-Hz and number of buckets
+    static const int snrBucket = 10;
+    static const int snrBuckets = 5;
+    // at least 3 satellites are needed for a 2D fix
+    static const int minInUseForFix = 3;
+
+    SatelliteSummary() : visible(0), inUse(0), bestSnr(0)
+    {
+        for (int i = 0; i < snrBuckets; ++i)
+            snrHistogram[i] = 0;
+    }
+
+    QVariantList histogram() const;
+
+    int visible;
+    int inUse;
+    int bestSnr;
+    int snrHistogram[snrBuckets];
+};
+
 extern "C"
 {
     IProviderPlugin* pluginFactory(const QString& constructionString);
@@ -39,12 +65,22 @@ public:
 
 private:
     static const QString skyhookService;
+    // the receiver counts as off when no Satellites signal came for this long
+    static const int receiverTimeout = 10000;
+    // how long a fix must stay lost before leaving "on"
+    static const int fixHoldTime = 5000;
 
-    QHash<QString,QVariant> Properties;
     QSet<QString> subscribedProps;
     LocationSkyHook *gpsDevice;
-    
-    void updateProperty(const QString& key, const QVariant& value);
+    LocationSample sample;
+    LocationFilter filter;
+    QString satPosState;
+    SatelliteSummary summary;
+    QTimer receiverTimer;
+    QTimer fixHoldTimer;
+
+    void updateSatPosState(const QString& state);
+    void updateSummary(const SatelliteSummary& next);
     void getCoordinates();
     void getHeading();
 
@@ -53,6 +89,8 @@ private slots:
     void emitSubscribeFinished();
     void onFirstSubscriberAppeared();
     void onLastSubscriberDisappeared();
+    void receiverStopped();
+    void fixLost();
     void locationChanged(double latitude, double longitude, double hpe, double altitude, double speed, double bearing, double timestamp);
     void satellitesChanged(QList<int> prns, QList<int> snrs, QList<int> elevations, QList<int> azimuths, QList<bool> inuse);
 
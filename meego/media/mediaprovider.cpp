@@ -10,9 +10,9 @@
  */
 
 #include "mediaprovider.h"
+#include "nowplaying.h"
 #include <QDebug>
 #include <QDBusConnection>
-#include <QDBusReply>
 #include <QStringList>
 #include <QVariant>
 #include <QString>
@@ -28,23 +28,11 @@ IProviderPlugin* pluginFactory(const QString& constructionString)
 }
 
 MediaProvider::MediaProvider()
+        : m_nowPlaying(NULL)
 {
         qDebug() << "MediaProvider::MediaProvider()";
 
         QMetaObject::invokeMethod(this,"ready",Qt::QueuedConnection);
-
-        musicPlayer = new Music("com.meego.app.music", "/com/meego/app/music", QDBusConnection::sessionBus(), 0);
-        QObject::connect(musicPlayer, SIGNAL(currentTrackMetadataChanged(QStringList)),
-            this, SLOT(getCurrentTrackMetadata()));
-
-        getCurrentTrackMetadata();
-
-        //sadly, QVariant is not a registered metatype
-        qRegisterMetaType<QVariant>("QVariant");
-
-        QMetaObject::invokeMethod(this, "valueChanged", Qt::QueuedConnection,
-                      Q_ARG(QString, ckit::now_playing),
-                      Q_ARG(QVariant, m_properties[ckit::now_playing]));
 }
 
 MediaProvider::~MediaProvider()
@@ -56,61 +44,47 @@ void MediaProvider::subscribe(QSet<QString> keys)
 {
     qDebug() << "MediaProvider::subscribe(" << QStringList(keys.toList()).join(", ") << ")";
 
-         m_subscribedProperties.unite(keys);
+    m_subscribedProperties.unite(keys);
+
+    if (!m_nowPlaying) {
+        m_nowPlaying = new NowPlaying(this);
+        connect(m_nowPlaying, SIGNAL(changed()), this, SLOT(emitChanged()));
+    }
 
-	QMetaObject::invokeMethod(this, "emitSubscribeFinished", Qt::QueuedConnection);
-        QMetaObject::invokeMethod(this, "emitChanged", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(this, "emitSubscribeFinished", Qt::QueuedConnection);
 }
 
 void MediaProvider::unsubscribe(QSet<QString> keys)
 {
     qDebug() << "MediaProvider::unsubscribe(" << QStringList(keys.toList()).join(", ") << ")";
     m_subscribedProperties.subtract(keys);
+
+    if (m_subscribedProperties.isEmpty()) {
+        delete m_nowPlaying;
+        m_nowPlaying = NULL;
+    }
 }
 
 void MediaProvider::emitSubscribeFinished()
 {
+        if (!m_nowPlaying)
+                return;
+
+        // players are still being queried if there is no value yet,
+        // emitChanged() delivers it later
+        QVariant value = m_nowPlaying->value();
         foreach(QString key, m_subscribedProperties){
-                emit subscribeFinished(key);
+                if (value.isNull())
+                        emit subscribeFinished(key);
+                else
+                        emit subscribeFinished(key, value);
         }
 }
 
 void MediaProvider::emitChanged()
 {
-  foreach (QString key, m_subscribedProperties) {
-    emit valueChanged(key, QVariant(m_properties[key]));
-  }
-}
+  if (!m_subscribedProperties.contains(ckit::now_playing))
+    return;
 
-void MediaProvider::getCurrentTrackMetadata()
-{
-    QStringList musicprops = musicPlayer->getCurrentTrackMetadata();
-    if(!musicPlayer->isValid() && musicprops.count() < 4){
-        qDebug() << "No valid metadata for the music app";
-        return;
-    }
-    qDebug() << "Music properties fetched " << musicprops;
-    QVariantMap metadata;
-    metadata["album"]= musicprops[0];
-    metadata["artist"] = musicprops[1];
-    metadata["title"]= musicprops[2];
-    metadata["duration"]= musicprops[3].toInt();
-    metadata["resource"] = ""; //tracker-uri object
-    metadata["genre"] = ""; //string
-    metadata["start-time"] = 0; //time
-    /*if(musicPlayer->getPlaybackState() && musicPlayer->getPlaybackState().value() == 0)
-        metadata["state"] = "unknown";
-    else if(musicPlayer->getPlaybackState().value() == 1)
-        metadata["state"] = "playing";
-    else if(musicPlayer->getPlaybackState().value() == 2)
-        metadata["state"] = "paused";
-    else if(musicPlayer->getPlaybackState().value() == 3)
-        metadata["state"] = "stopped";
-    else if(musicPlayer->getPlaybackState().value() == 4)
-        metadata["state"] = "fastforward";
-    else if(musicPlayer->getPlaybackState().value() == 5)
-        metadata["state"] = "rewind"; */
-    m_properties[ckit::now_playing] = metadata;
-    if (m_subscribedProperties.contains(ckit::now_playing))
-        emitChanged();
+  emit valueChanged(ckit::now_playing, m_nowPlaying->value());
 }
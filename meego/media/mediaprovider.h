@@ -17,10 +17,11 @@
 #include <QObject>
 #include <iproviderplugin.h>
 #include <contextproperty.h>
-#include "music_interface.h"
 
 using ContextSubscriber::IProviderPlugin;
 
+class NowPlaying;
+
 extern "C"
 {
 	IProviderPlugin* pluginFactory(const QString& constructionString);
@@ -41,13 +42,11 @@ public:
 
 private:
         QSet<QString> m_subscribedProperties;
-        QVariantMap m_properties;
-        Music *musicPlayer; ///< The interface to the music app
+        NowPlaying *m_nowPlaying; ///< MPRIS2 players tracker, exists while subscribed
 
 private slots:
         void emitSubscribeFinished();
         void emitChanged();
-        void getCurrentTrackMetadata();
 };
 
 #endif // MEDIAPROVIDER_H
@@ -0,0 +1,301 @@
+/*  -*- Mode: C++ -*-
+ *
+ * contextkit-meego
+ * Copyright © 2010, Intel Corporation.
+ *
+ * This program is licensed under the terms and conditions of the
+ * Apache License, version 2.0.  The full text of the Apache License is at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ */
+
+#include "nowplaying.h"
+#include <QDebug>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QElapsedTimer>
+
+static const QString dbusService("org.freedesktop.DBus");
+static const QString dbusPath("/org/freedesktop/DBus");
+static const QString propertiesInterface("org.freedesktop.DBus.Properties");
+static const QString mprisPrefix("org.mpris.MediaPlayer2.");
+static const QString mprisPath("/org/mpris/MediaPlayer2");
+static const QString playerInterface("org.mpris.MediaPlayer2.Player");
+
+NowPlaying::NowPlaying(QObject *parent)
+	: QObject(parent)
+{
+	QDBusConnection bus = QDBusConnection::sessionBus();
+
+	bus.connect(dbusService, dbusPath, dbusService, "NameOwnerChanged",
+		    this, SLOT(nameOwnerChanged(QString, QString, QString)));
+	// any sender, the player is identified by the unique name
+	bus.connect(QString(), mprisPath, propertiesInterface, "PropertiesChanged",
+		    this, SLOT(propertiesChanged(QString, QVariantMap, QStringList)));
+	bus.connect(QString(), mprisPath, playerInterface, "Seeked",
+		    this, SLOT(seeked(qlonglong)));
+
+	QDBusMessage msg = QDBusMessage::createMethodCall
+		(dbusService, dbusPath, dbusService, "ListNames");
+	QDBusPendingCallWatcher *watcher
+		= new QDBusPendingCallWatcher(bus.asyncCall(msg), this);
+	connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+		this, SLOT(listNamesFinished(QDBusPendingCallWatcher*)));
+}
+
+NowPlaying::~NowPlaying()
+{
+	QDBusConnection bus = QDBusConnection::sessionBus();
+
+	bus.disconnect(dbusService, dbusPath, dbusService, "NameOwnerChanged",
+		       this, SLOT(nameOwnerChanged(QString, QString, QString)));
+	bus.disconnect(QString(), mprisPath, propertiesInterface, "PropertiesChanged",
+		       this, SLOT(propertiesChanged(QString, QVariantMap, QStringList)));
+	bus.disconnect(QString(), mprisPath, playerInterface, "Seeked",
+		       this, SLOT(seeked(qlonglong)));
+}
+
+QVariant NowPlaying::value() const
+{
+	if (current.isEmpty())
+		return QVariant();
+	return current;
+}
+
+// milliseconds of the monotonic clock, comparable between processes
+qint64 NowPlaying::monotonicTime()
+{
+	QElapsedTimer clock;
+	clock.start();
+	return clock.msecsSinceReference();
+}
+
+qlonglong NowPlaying::positionAt(const Player &player, qint64 now) const
+{
+	qlonglong position = player.position;
+	if (player.status == "Playing")
+		position += qlonglong(player.rate * (now - player.anchor) * 1000);
+
+	qlonglong length = player.metadata.value("mpris:length").toLongLong();
+	if (length > 0 && position > length)
+		position = length;
+	return position < 0 ? 0 : position;
+}
+
+void NowPlaying::listNamesFinished(QDBusPendingCallWatcher *watcher)
+{
+	QDBusPendingReply<QStringList> reply = *watcher;
+	watcher->deleteLater();
+
+	if (reply.isError()) {
+		qWarning() << "NowPlaying: ListNames failed:" << reply.error().message();
+		return;
+	}
+
+	QDBusConnection bus = QDBusConnection::sessionBus();
+	foreach (const QString &name, reply.value()) {
+		if (!name.startsWith(mprisPrefix))
+			continue;
+
+		QDBusMessage msg = QDBusMessage::createMethodCall
+			(dbusService, dbusPath, dbusService, "GetNameOwner");
+		msg << name;
+		QDBusPendingCallWatcher *ownerWatcher
+			= new QDBusPendingCallWatcher(bus.asyncCall(msg), this);
+		pendingCalls[ownerWatcher] = name;
+		connect(ownerWatcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+			this, SLOT(getNameOwnerFinished(QDBusPendingCallWatcher*)));
+	}
+}
+
+void NowPlaying::getNameOwnerFinished(QDBusPendingCallWatcher *watcher)
+{
+	QString service = pendingCalls.take(watcher);
+	QDBusPendingReply<QString> reply = *watcher;
+	watcher->deleteLater();
+
+	if (reply.isError())
+		return; // player went away meanwhile
+
+	addPlayer(service, reply.value());
+}
+
+void NowPlaying::nameOwnerChanged(const QString &name, const QString &oldOwner,
+				  const QString &newOwner)
+{
+	if (!name.startsWith(mprisPrefix))
+		return;
+
+	if (!oldOwner.isEmpty() && players.remove(oldOwner))
+		update();
+
+	if (!newOwner.isEmpty())
+		addPlayer(name, newOwner);
+}
+
+void NowPlaying::addPlayer(const QString &service, const QString &owner)
+{
+	qDebug() << "NowPlaying: player" << service << "at" << owner;
+	players[owner].service = service;
+	getAll(owner);
+}
+
+void NowPlaying::getAll(const QString &owner)
+{
+	QDBusMessage msg = QDBusMessage::createMethodCall
+		(owner, mprisPath, propertiesInterface, "GetAll");
+	msg << playerInterface;
+	QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher
+		(QDBusConnection::sessionBus().asyncCall(msg), this);
+	pendingCalls[watcher] = owner;
+	connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)),
+		this, SLOT(getAllFinished(QDBusPendingCallWatcher*)));
+}
+
+void NowPlaying::getAllFinished(QDBusPendingCallWatcher *watcher)
+{
+	QString owner = pendingCalls.take(watcher);
+	QDBusPendingReply<QVariantMap> reply = *watcher;
+	watcher->deleteLater();
+
+	if (reply.isError()) {
+		qWarning() << "NowPlaying: GetAll failed for" << owner
+			   << reply.error().message();
+		return;
+	}
+
+	QHash<QString, Player>::iterator it = players.find(owner);
+	if (it == players.end())
+		return;
+
+	QVariantMap props = reply.value();
+	apply(*it, props);
+	// GetAll is the only place Position is read from the player
+	it->position = props.value("Position").toLongLong();
+	it->anchor = monotonicTime();
+	update();
+}
+
+void NowPlaying::propertiesChanged(const QString &interface,
+				   const QVariantMap &changed,
+				   const QStringList &invalidated)
+{
+	if (interface != playerInterface)
+		return;
+
+	QString owner = message().service();
+	QHash<QString, Player>::iterator it = players.find(owner);
+	if (it == players.end())
+		return; // not known yet, GetAll is on its way
+
+	apply(*it, changed);
+	if (invalidated.contains("Metadata") || invalidated.contains("PlaybackStatus"))
+		getAll(owner);
+	update();
+}
+
+void NowPlaying::seeked(qlonglong position)
+{
+	QHash<QString, Player>::iterator it = players.find(message().service());
+	if (it == players.end())
+		return;
+
+	it->position = position;
+	it->anchor = monotonicTime();
+	update();
+}
+
+void NowPlaying::apply(Player &player, const QVariantMap &props)
+{
+	QVariantMap::const_iterator it;
+	QString status = player.status;
+	double rate = player.rate;
+
+	it = props.find("PlaybackStatus");
+	if (it != props.end())
+		status = it->toString();
+
+	it = props.find("Rate");
+	if (it != props.end())
+		rate = it->toDouble();
+
+	// re-anchor only when the extrapolation changes, so the published
+	// anchor stays put otherwise
+	if (status != player.status || rate != player.rate) {
+		qint64 now = monotonicTime();
+		player.position = positionAt(player, now);
+		player.anchor = now;
+		player.status = status;
+		player.rate = rate;
+	}
+
+	it = props.find("Metadata");
+	if (it != props.end()) {
+		QVariantMap metadata = qdbus_cast<QVariantMap>(*it);
+		if (metadata.value("mpris:trackid") != player.metadata.value("mpris:trackid")) {
+			player.position = 0; // new track
+			player.anchor = monotonicTime();
+		}
+		player.metadata = metadata;
+	}
+
+	if (player.status == "Stopped")
+		player.position = 0;
+}
+
+// playing player wins, the current one is preferred among equals
+QString NowPlaying::selectActive() const
+{
+	static const char *preference[] = { "Playing", "Paused" };
+
+	for (unsigned i = 0; i < sizeof(preference) / sizeof(preference[0]); ++i) {
+		QHash<QString, Player>::const_iterator it = players.find(active);
+		if (it != players.end() && it->status == preference[i])
+			return active;
+		for (it = players.begin(); it != players.end(); ++it)
+			if (it->status == preference[i])
+				return it.key();
+	}
+
+	if (players.contains(active))
+		return active;
+	return players.isEmpty() ? QString() : players.begin().key();
+}
+
+void NowPlaying::update()
+{
+	active = selectActive();
+
+	QVariantMap now;
+	QHash<QString, Player>::const_iterator it = players.find(active);
+	if (it != players.end()) {
+		const QVariantMap &md = it->metadata;
+		QString title = md.value("xesam:title").toString();
+		QString url = md.value("xesam:url").toString();
+
+		if (!title.isEmpty() || !url.isEmpty()) {
+			now["album"] = md.value("xesam:album").toString();
+			now["artist"] = md.value("xesam:artist").toStringList().join(", ");
+			now["title"] = title;
+			// mpris:length is in microseconds
+			now["duration"] = int(md.value("mpris:length").toLongLong() / 1000000);
+			now["resource"] = url;
+			now["genre"] = md.value("xesam:genre").toStringList().join(", ");
+			now["start-time"] = 0;
+			now["state"] = it->status.toLower();
+			now["rate"] = it->rate;
+			// position (seconds) as of position-time; consumers
+			// extrapolate with rate while the state is "playing"
+			now["position"] = double(it->position) / 1000000;
+			now["position-time"] = it->anchor;
+		}
+	}
+
+	if (now == current)
+		return;
+
+	current = now;
+	emit changed();
+}
@@ -0,0 +1,88 @@
+/*  -*- Mode: C++ -*-
+ *
+ * contextkit-meego
+ * Copyright © 2010, Intel Corporation.
+ *
+ * This program is licensed under the terms and conditions of the
+ * Apache License, version 2.0.  The full text of the Apache License is at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ */
+
+#ifndef NOWPLAYING_H
+#define NOWPLAYING_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QDBusContext>
+
+class QDBusPendingCallWatcher;
+
+/*
+ * Tracks all MPRIS2 players on the session bus and maintains
+ * Media.NowPlaying for the active one. Player state is cached and
+ * updated from PropertiesChanged; the bus is only queried (always
+ * asynchronously) when a player appears or invalidates properties.
+ *
+ * Playback position is not polled: it is kept as a (position, rate,
+ * time) anchor, re-anchored on Seeked, PlaybackStatus and Rate changes.
+ * The anchor itself is published (position, rate and position-time, in
+ * monotonic clock milliseconds), and subscribers extrapolate from it;
+ * the value only changes when the anchor does.
+ */
+class NowPlaying : public QObject, protected QDBusContext
+{
+	Q_OBJECT
+
+public:
+	NowPlaying(QObject *parent = 0);
+	virtual ~NowPlaying();
+
+	QVariant value() const;
+
+Q_SIGNALS:
+	void changed();
+
+private Q_SLOTS:
+	void listNamesFinished(QDBusPendingCallWatcher *watcher);
+	void getNameOwnerFinished(QDBusPendingCallWatcher *watcher);
+	void getAllFinished(QDBusPendingCallWatcher *watcher);
+	void nameOwnerChanged(const QString &name, const QString &oldOwner,
+			      const QString &newOwner);
+	void propertiesChanged(const QString &interface,
+			       const QVariantMap &changed,
+			       const QStringList &invalidated);
+	void seeked(qlonglong position);
+
+private:
+	struct Player
+	{
+		Player() : position(0), rate(1.0), anchor(0) {}
+
+		QString service;
+		QString status;
+		QVariantMap metadata;
+		qlonglong position; // microseconds at anchor
+		double rate;
+		qint64 anchor; // monotonic ms when position was valid
+	};
+
+	void addPlayer(const QString &service, const QString &owner);
+	void getAll(const QString &owner);
+	void apply(Player &player, const QVariantMap &props);
+	qlonglong positionAt(const Player &player, qint64 now) const;
+	static qint64 monotonicTime();
+	QString selectActive() const;
+	void update();
+
+	// players by their unique bus name
+	QHash<QString, Player> players;
+	QHash<QDBusPendingCallWatcher *, QString> pendingCalls;
+	QString active;
+	QVariantMap current;
+};
+
+#endif // NOWPLAYING_H
@@ -9,10 +9,9 @@
  *
  */
 
-//#include "common.h"
+#include "common.h"
 #include "callitem.h"
 #include "callitemmodel.h"
-#include <QDebug>
 
 
 CallItem::CallItem(const QString path )
@@ -113,7 +112,7 @@ void CallItem::click()
 
 void CallItem::callStateChanged(QString &state)
 {
-	qDebug()<<"CallItem: callStateChanged :"<<state;
+	contextDebug() << F_PHONE << "CallItem: callStateChanged:" << state;
 
 	if (state == "active")
 		m_state = CallItemModel::STATE_ACTIVE;
@@ -132,7 +131,7 @@ void CallItem::callStateChanged(QString &state)
 	else
 		m_state = CallItemModel::STATE_NONE;  
 
-	qDebug()<<"CallItem: callstatechanged m_statec hanged:"<<m_state;
+	contextDebug() << F_PHONE << "CallItem: m_state changed:" << m_state;
 	emit stateChanged();
 }
 
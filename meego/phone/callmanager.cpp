@@ -64,7 +64,7 @@ CallItem *CallManager::activeCall() const
 	if (m_callItems.size())
 	foreach (CallItem *c, m_callItems)
 	{
-		qDebug()<<"CallManager state = "<<c->state();	
+		contextDebug() << F_PHONE << "CallManager state =" << c->state();
 		if (c->state() == CallItemModel::STATE_ACTIVE)
 			return c;
 	}
@@ -170,7 +170,7 @@ void CallManager::updateCallItems()
 
 	// If ofono call list is empty (no calls), empty our CallItem list too.
 	if (m_calls.isEmpty() && !m_callItems.isEmpty()) {
-		qDebug() << QString("Purging all CallItems");
+		contextDebug() << F_PHONE << "Purging all CallItems";
 		foreach (CallItem *item, m_callItems) {
 			disconnect(item, SIGNAL(stateChanged()));
 			delete item;
@@ -186,7 +186,7 @@ void CallManager::updateCallItems()
 		CallItem *item = iter.next();
 		// This item is not in the ofono list, remove it
 		if (!m_calls.contains(item->path())) {
- 			qDebug() << QString("Removing old CallItem %1").arg(item->path());
+ 			contextDebug() << F_PHONE << "Removing old CallItem" << item->path();
 			disconnect(item, SIGNAL(stateChanged()));
 			delete item;
 			iter.remove();
@@ -206,7 +206,7 @@ void CallManager::updateCallItems()
         	}
 	// Insert a new CallItem
 	if (!matchFound) {
-            qDebug() << QString("Inserting new CallItem %1").arg(callPath);
+            contextDebug() << F_PHONE << "Inserting new CallItem" << callPath;
             CallItem *call = new CallItem(callPath);
             connect (call, SIGNAL(stateChanged()), SLOT(callStateChanged()));
             m_callItems << call;
@@ -232,7 +232,7 @@ void CallManager::updateMultipartyCallItems()
 	// If ofono multiparty call list is empty (no calls), empty our
 	// multiparty CallItem list too.
 	if (m_multipartyCalls.isEmpty() && !m_multipartyCallItems.isEmpty()) {
-		qDebug() << QString("Purging all multiparty CallItems");
+		contextDebug() << F_PHONE << "Purging all multiparty CallItems";
 		foreach (CallItem *item, m_multipartyCallItems) delete item;
 	        m_multipartyCallItems.clear();
 		return;
@@ -244,8 +244,8 @@ void CallManager::updateMultipartyCallItems()
 		CallItem *item = iter.next();
  		// This item is not in the ofono list, remove it
 		if (!m_multipartyCalls.contains(item->path())) {
-			qDebug() << QString("Removing old multiparty CallItem %1")
-			.arg(item->path());
+			contextDebug() << F_PHONE << "Removing old multiparty CallItem"
+				       << item->path();
 			delete item;
 			iter.remove();
 		}
@@ -264,8 +264,8 @@ void CallManager::updateMultipartyCallItems()
 		// Insert a new CallItem
 		if (!matchFound) {
 			m_multipartyCallItems << new CallItem(callPath);
-			qDebug() << QString("Inserting new multiparty CallItem %1")
-			.arg(callPath);
+			contextDebug() << F_PHONE << "Inserting new multiparty CallItem"
+				       << callPath;
         	}
     	}
 }
@@ -336,7 +336,7 @@ void CallManager::dialFinished(QDBusPendingCallWatcher *watcher)
 		return;
 	} else {
 		QDBusObjectPath val = reply.value();
-		qDebug() << QString("Dial() Success: path == %1").arg(val.path());
+		contextDebug() << F_PHONE << "Dial() Success: path ==" << val.path();
 	}
 }
 
@@ -368,7 +368,7 @@ void CallManager::holdAndAnswerFinished(QDBusPendingCallWatcher *watcher)
 void CallManager::propertyChanged(const QString &in0, const QDBusVariant &in1)
 {
 	Q_UNUSED(in1)
-	qDebug() << QString("Property \"%1\" changed...").arg(in0);
+	contextDebug() << F_PHONE << "Property" << in0 << "changed...";
 	if (in0 == "Calls") {
 		QList<QDBusObjectPath> calls;
 		calls = qdbus_cast<QList<QDBusObjectPath> >(in1.variant());
@@ -378,18 +378,16 @@ void CallManager::propertyChanged(const QString &in0, const QDBusVariant &in1)
 		calls = qdbus_cast<QList<QDBusObjectPath> >(in1.variant());
 		setMultipartyCalls(calls);
 	} else if (in0 == "EmergencyNumbers") {
-		qDebug() << QString("TODO: Handle EmergencyNumber...");
+		contextDebug() << F_PHONE << "TODO: Handle EmergencyNumber...";
 	} else
-		qDebug() << QString("Unexpected property changed...");
+		contextDebug() << F_PHONE << "Unexpected property changed...";
 }
 
 void CallManager::callStateChanged()
 {
 	CallItem *call = dynamic_cast<CallItem *>(sender());
-	qDebug() << QString("%1 (%2) state has changed to %3")
-		.arg(call->path())
-		.arg(call->lineID())
-		.arg(call->state());
+	contextDebug() << F_PHONE << call->path() << "(" << call->lineID()
+		       << ") state has changed to" << call->state();
 	emit callsChanged();
 }
 
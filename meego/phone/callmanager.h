@@ -15,7 +15,6 @@
 #include "callitem.h"
 #include "callmanager_interface.h"
 #include <QtDBus>
-#include <QDebug>
 
 #define OFONO_SERVICE "org.ofono"
 #define OFONO_MANAGER_PATH "/"
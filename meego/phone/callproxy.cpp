@@ -162,7 +162,7 @@ void CallProxy::getPropertiesFinished(QDBusPendingCallWatcher *watcher)
 
 	m_lineid = qdbus_cast<QString>(props["LineIdentification"]);
 	m_state  = qdbus_cast<QString>(props["State"]);
-	qDebug()<<"CallProxy: updating props"<<m_state;
+	contextDebug() << F_PHONE << "CallProxy: updating props" << m_state;
 	l_start  = qdbus_cast<QString>(props["StartTime"]);
 
 	setStartTimeFromString(l_start);
@@ -216,7 +216,7 @@ void CallProxy::propertyChanged(const QString &in0, const QDBusVariant &in1)
 		if (!m_startTime.isValid()) // No start time set yet
 		setStartTimeFromString(qdbus_cast<QString>(in1.variant()));
 	} else {
-		qDebug() << QString("Unexpected property \"%1\" changed...").arg(in0);
+		contextDebug() << F_PHONE << "Unexpected property" << in0 << "changed...";
 	}
 }
 
@@ -14,7 +14,6 @@
 
 #include "voicecall_interface.h"
 #include <QtDBus>
-#include <QDebug>
 
 #define OFONO_SERVICE "org.ofono"
 #define OFONO_MANAGER_PATH "/"
@@ -1,4 +1,9 @@
 #include "common.h"
+#include <stdlib.h>
+
+#if !defined(WANT_DEBUG) && defined(WANT_TRACEPOINTS)
+bool phoneTraceEnabled = (getenv("CONTEXT_PHONE_TRACE") != NULL);
+#endif
 
 QDBusArgument & operator << (QDBusArgument &argument,
                              const OfonoPathProperties &d)
@@ -18,11 +18,23 @@
 #include <QDBusObjectPath>
 #include <QDBusPendingCallWatcher>
 
-#ifndef WANT_DEBUG
-#define TRACE
+#include "logging.h"
+#include "loggingfeatures.h"
+
+/*
+ * TRACE marks function entry, file/line/function are supplied by the
+ * logger itself. It is compiled out entirely unless WANT_DEBUG or
+ * WANT_TRACEPOINTS is defined. Tracepoints are meant for production
+ * builds: they cost a single flag test unless CONTEXT_PHONE_TRACE is
+ * set in the environment.
+ */
+#if defined(WANT_DEBUG)
+#define TRACE contextDebug() << F_PHONE_TRACE;
+#elif defined(WANT_TRACEPOINTS)
+extern bool phoneTraceEnabled;
+#define TRACE do { if (phoneTraceEnabled) contextDebug() << F_PHONE_TRACE; } while (0);
 #else
-#include <QDebug>
-#define TRACE qDebug()<<QString("[%1] %2(): %3").arg(__FILE__).arg(__func__).arg(__LINE__);
+#define TRACE
 #endif
 
 /*
@@ -0,0 +1,18 @@
+/*  -*- Mode: C++ -*-
+ *
+ * contextkit-meego
+ * Copyright © 2010, Intel Corporation.
+ *
+ * This program is licensed under the terms and conditions of the
+ * Apache License, version 2.0.  The full text of the Apache License is at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ */
+
+#ifndef PHONE_LOGGINGFEATURES_H
+#define PHONE_LOGGINGFEATURES_H
+
+#define F_PHONE         (ContextFeature("phone"))
+#define F_PHONE_TRACE   (ContextFeature("phone-trace"))
+
+#endif // PHONE_LOGGINGFEATURES_H
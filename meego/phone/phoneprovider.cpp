@@ -27,7 +27,7 @@ IProviderPlugin* pluginFactory(const QString& constructionString)
 
 PhoneProvider::PhoneProvider():m_currCalls(0),m_currMpartyCalls(0),m_currActiveCall(new CallItem(QString("")))
 {
-	qDebug() << "PhoneProvider" << "Initializing phone provider";
+	contextDebug() << F_PHONE << "Initializing phone provider";
 	registerContextDataTypes();
 	QMetaObject::invokeMethod(this,"ready",Qt::QueuedConnection);
 }
@@ -54,7 +54,7 @@ void PhoneProvider::unsubscribe(QSet<QString> keys)
 
 void PhoneProvider::initProvider()
 {
-	qDebug() << "PhoneProvider" << "First subscriber appeared, connecting to CallVolume";
+	contextDebug() << F_PHONE << "First subscriber appeared, connecting to CallVolume";
 	
         Manager managerProxy("org.ofono",
 				  "/",
@@ -94,12 +94,12 @@ void PhoneProvider::initProvider()
 
 	if (!volumeProps)
 	{
-		qDebug() << "PhoneProvider" << "Couldn't connect to CallVolume interface";
+		contextDebug() << F_PHONE << "Couldn't connect to CallVolume interface";
 	}
 
 	if (!callProps)
 	{
-		qDebug() << "PhoneProvider" << "Couldn't connect to CallMananger interface";
+		contextDebug() << F_PHONE << "Couldn't connect to CallMananger interface";
 	}
 }
 
@@ -113,7 +113,7 @@ QList<QDBusObjectPath> PhoneProvider::providerProcessGetModems(QDBusPendingCallW
                       reply.error().message();
     } else {
         QArrayOfPathProperties modems = reply.value();
-        qDebug() << QString("modem count:")<<modems.count();
+        contextDebug() << F_PHONE << "modem count:" << modems.count();
         for (int i=0; i< modems.count();i++) {
             OfonoPathProperties p = modems[i];
             pathlist.append(QDBusObjectPath(p.path.path()));
@@ -124,7 +124,7 @@ QList<QDBusObjectPath> PhoneProvider::providerProcessGetModems(QDBusPendingCallW
 
 void PhoneProvider::cleanProvider()
 {
-	qDebug() << "PhoneProvider" << "Last subscriber gone, destroying CellularProvider connections";
+	contextDebug() << F_PHONE << "Last subscriber gone, destroying CellularProvider connections";
 
 	delete callProps;
 	callProps = NULL;
@@ -135,7 +135,7 @@ void PhoneProvider::cleanProvider()
 
 void PhoneProvider::updateProperty(const QString &key, const QDBusVariant &val)
 {
-	qDebug()<<"PhoneProvider:"<<key;
+	contextDebug() << F_PHONE << "PhoneProvider:" << key;
 
 	if(key == "Muted")
 	{
@@ -149,7 +149,7 @@ void PhoneProvider::updateProperty(const QString &key, const QDBusVariant &val)
 
 void PhoneProvider::updateCall()
 {
-	qDebug()<<"PhoneProvider: callChanged Signal received";
+	contextDebug() << F_PHONE << "PhoneProvider: callChanged Signal received";
 
 	if(!callProps) return;
 
@@ -164,22 +164,22 @@ void PhoneProvider::updateCall()
 			// A new call is in active state
 			if(prevActiveCall->path() != prevActiveCall->path())
 			{
-				qDebug()<<"Assigning Active";	
+				contextDebug() << F_PHONE << "Assigning Active";
 				props[ckit::call] = QVariant("active");
 			}
 
 		}else {
 			// call is in active state
-			qDebug()<<"Assigning Active";	
+			contextDebug() << F_PHONE << "Assigning Active";
 			props[ckit::call] = QVariant("active");
 		}
 	} else {
         	uint prevRingingCalls = m_currCalls+m_currMpartyCalls;
-		qDebug()<<"updateCalls: Counting calls";
+		contextDebug() << F_PHONE << "updateCalls: Counting calls";
 		m_currCalls = (callProps->calls()).count();
 		m_currMpartyCalls = (callProps->multipartyCalls()).count();
-		qDebug()<<"updateCall: prevRingingCalls:"<<prevRingingCalls;
-		qDebug()<<"updateCall: currCalls:"<<m_currCalls;
+		contextDebug() << F_PHONE << "updateCall: prevRingingCalls:" << prevRingingCalls;
+		contextDebug() << F_PHONE << "updateCall: currCalls:" << m_currCalls;
 		if (prevRingingCalls < (m_currCalls+m_currMpartyCalls))
 			props[ckit::call] = QVariant("ringing");
 		else if (prevRingingCalls > (m_currCalls+m_currMpartyCalls))
@@ -192,7 +192,7 @@ void PhoneProvider::updateCall()
 }
 void PhoneProvider::updateProperties()
 {
-	qDebug()<<"PhoneProvider: updateProperties";
+	contextDebug() << F_PHONE << "PhoneProvider: updateProperties";
 
 	if(!volumeProps ) return;
 
@@ -208,12 +208,12 @@ void PhoneProvider::updateProperties()
 			props[ckit::call] = QVariant("active");
         }
 	else {
-		qDebug()<<"updateProperties activecall is null";	
+		contextDebug() << F_PHONE << "updateProperties activecall is null";
         	uint prevRingingCalls = m_currCalls+m_currMpartyCalls;
 		m_currCalls = (callProps->calls()).count();
 		m_currMpartyCalls = (callProps->multipartyCalls()).count();
-		qDebug()<<"ups: prevRingingCalls:"<<prevRingingCalls;
-		qDebug()<<"ups: currRingingCalls:"<<m_currCalls;
+		contextDebug() << F_PHONE << "ups: prevRingingCalls:" << prevRingingCalls;
+		contextDebug() << F_PHONE << "ups: currRingingCalls:" << m_currCalls;
 		if (prevRingingCalls < (m_currCalls+m_currMpartyCalls))
 			props[ckit::call] = QVariant("ringing");
 		else if (prevRingingCalls > (m_currCalls+m_currMpartyCalls))
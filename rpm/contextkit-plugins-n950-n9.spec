@@ -41,7 +41,7 @@ Provides:   %{g_power}
 %{summary}
 
 %package %{p_kbslider}
-Summary:    Slider keyboard ContextKit plugin
+Summary:    Slider keyboard and switches ContextKit plugin
 Group:      Applications/System
 BuildRequires: pkgconfig(udev)
 Provides:   %{g_keyboard}
@@ -78,6 +78,7 @@ update-contextkit-providers
 %defattr(-,root,root,-)
 %{plugins_dir}/kbslider.so
 %{context_dir}/kbslider.context
+%{context_dir}/kbslider-switches.context
 
 %post %{p_kbslider}
 update-contextkit-providers
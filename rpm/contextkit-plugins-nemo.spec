@@ -81,7 +81,7 @@ Provides: %{g_power}
 Summary:    Session ContextKit plugin
 License: LGPLv2
 Group:      Applications/System
-BuildRequires: pkgconfig(x11)
+BuildRequires: pkgconfig(xcb)
 %description %{p_session}
 %{summary}
 
@@ -284,6 +284,7 @@ update-contextkit-providers
 %defattr(-,root,root,-)
 %{plugins_dir}/location-skyhook.so
 %{context_dir}/location-skyhook.context
+%{context_dir}/location-skyhook-satellites.context
 
 %post %{p_skyhook}
 update-contextkit-providers
@@ -0,0 +1,88 @@
+/*
+ * Benchmark of the evdev capability bitmaps
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: Denis Zalevskiy <denis.zalevskiy@jollamobile.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <cor/evdev.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// What the keyboard plugins do for every input device on each udev
+// event: parse capabilities/key and check for the qwerty row.
+
+static char const *keyboard = sizeof(long) == 8
+    ? "1000000000007 ff9f207ac14057ff febeffdfffefffff fffffffffffffffe\n"
+    : "10000 7 ff9f207a c14057ff febeffdf ffefffff ffffffff fffffffe\n";
+
+static char const *mouse = "1f0000 0 0 0 0\n";
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned run(char const *caps, unsigned iterations)
+{
+    unsigned found = 0;
+    for (unsigned i = 0; i < iterations; ++i) {
+        cor::evdev::KeyBits keys;
+        if (keys.parse(caps) && cor::evdev::has_qwerty_row(keys))
+            ++found;
+    }
+    return found;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned iterations = argc > 1 ? strtoul(argv[1], 0, 10) : 100000;
+    if (!iterations)
+        iterations = 1;
+
+    struct {
+        char const *name;
+        char const *caps;
+        unsigned expected;
+    } cases[] = {
+        { "keyboard", keyboard, iterations },
+        { "mouse", mouse, 0 },
+    };
+
+    for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        double start = now();
+        unsigned found = run(cases[i].caps, iterations);
+        double elapsed = now() - start;
+        printf("%-10s %8.1f ns/parse\n", cases[i].name,
+               elapsed * 1e9 / iterations);
+        if (found != cases[i].expected) {
+            fprintf(stderr, "%s: wrong result\n", cases[i].name);
+            return 1;
+        }
+    }
+    return 0;
+}
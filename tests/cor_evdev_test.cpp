@@ -0,0 +1,243 @@
+/*
+ * Tests of the evdev capability bitmaps
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: Denis Zalevskiy <denis.zalevskiy@jollamobile.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <cor/evdev.hpp>
+
+#include <stdint.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                        \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                         \
+        }                                                       \
+    } while (0)
+
+using cor::evdev::Bitmap;
+using cor::evdev::KeyBits;
+using cor::evdev::SwitchBits;
+
+typedef Bitmap<KEY_MAX + 1, uint32_t> KeyBits32;
+typedef Bitmap<KEY_MAX + 1, uint64_t> KeyBits64;
+
+// capabilities/key of a usb keyboard as a 64-bit kernel shows it...
+static char const *keyboard64 =
+    "1000000000007 ff9f207ac14057ff febeffdfffefffff fffffffffffffffe\n";
+// ...and as a 32-bit one does
+static char const *keyboard32 =
+    "10000 7 ff9f207a c14057ff febeffdf ffefffff ffffffff fffffffe\n";
+
+template <typename B>
+static void check_keyboard(B const &keys)
+{
+    CHECK(!keys.test(0));
+    CHECK(keys.test(KEY_ESC));
+    CHECK(keys.test_range(KEY_ESC, 63));
+    CHECK(keys.test_range(KEY_Q, KEY_P));
+    CHECK(keys.test(192) && keys.test(193) && keys.test(194));
+    CHECK(!keys.test(195));
+    CHECK(keys.test(240));
+    CHECK(!keys.test(241));
+    CHECK(!keys.test(KEY_MAX));
+}
+
+static void test_full_keyboard()
+{
+    KeyBits keys;
+    CHECK(keys.parse(sizeof(long) == 8 ? keyboard64 : keyboard32));
+    CHECK(keys.any());
+    CHECK(cor::evdev::has_qwerty_row(keys));
+    check_keyboard(keys);
+}
+
+// the same bits whatever the word size, as long as the string is in
+// the format of that word size
+static void test_word_layout()
+{
+    KeyBits32 k32;
+    KeyBits64 k64;
+    CHECK(k32.parse(keyboard32));
+    CHECK(k64.parse(keyboard64));
+    check_keyboard(k32);
+    check_keyboard(k64);
+    for (unsigned i = 0; i <= KEY_MAX; ++i)
+        CHECK(k32.test(i) == k64.test(i));
+
+    CHECK(KeyBits32::bits_per_word == 32);
+    CHECK(KeyBits64::bits_per_word == 64);
+    CHECK(KeyBits32::size() == KeyBits32::words_count * 4);
+    CHECK(KeyBits64::size() == KeyBits64::words_count * 8);
+
+    // the words are filled from the end of the string
+    CHECK(k32.data()[0] == 0xfffffffeU);
+    CHECK(k32.data()[7] == 0x10000U);
+    CHECK(k64.data()[0] == 0xfffffffffffffffeULL);
+    CHECK(k64.data()[3] == 0x1000000000007ULL);
+
+    // a 64-bit word is too long for the 32-bit layout
+    CHECK(!k32.parse(keyboard64));
+    CHECK(!k32.any());
+
+    // a range spanning words
+    Bitmap<96, uint32_t> b;
+    CHECK(b.parse("3 c0000000"));
+    CHECK(b.test_range(30, 33));
+    CHECK(!b.test_range(29, 33));
+    CHECK(!b.test_range(30, 34));
+}
+
+static void test_partial_row()
+{
+    KeyBits keys;
+    for (unsigned k = KEY_Q; k < KEY_P; ++k)
+        keys.set(k);
+    CHECK(!cor::evdev::has_qwerty_row(keys));
+    keys.set(KEY_P);
+    CHECK(cor::evdev::has_qwerty_row(keys));
+    keys.reset(KEY_T);
+    CHECK(!cor::evdev::has_qwerty_row(keys));
+
+    // KEY_Q..KEY_O only, as e.g. a numeric keypad might report
+    CHECK(keys.parse("1ff0000"));
+    CHECK(keys.test_range(KEY_Q, KEY_O));
+    CHECK(!cor::evdev::has_qwerty_row(keys));
+    CHECK(keys.parse("3ff0000"));
+    CHECK(cor::evdev::has_qwerty_row(keys));
+}
+
+static void test_multi_word()
+{
+    Bitmap<256, uint32_t> b;
+    CHECK(b.parse("3 0 0 fffffffe"));
+    CHECK(!b.test(0));
+    CHECK(b.test_range(1, 31));
+    CHECK(!b.test(32) && !b.test(95));
+    CHECK(b.test(96) && b.test(97));
+    CHECK(!b.test(98));
+
+    // leading zero words may or may not be there
+    Bitmap<256, uint32_t> c;
+    CHECK(c.parse("0 0 3 0 0 fffffffe"));
+    CHECK(b.contains(c) && c.contains(b));
+
+    Bitmap<256, uint32_t> d;
+    CHECK(!b.intersects(d));
+    d.set(200);
+    CHECK(!b.intersects(d));
+    d.set(97);
+    CHECK(b.intersects(d));
+    CHECK(!b.contains(d));
+}
+
+static void test_whitespace()
+{
+    Bitmap<64, uint32_t> b;
+    CHECK(b.parse("  1\t\t2  \n"));
+    CHECK(b.test(1) && b.test(32));
+    CHECK(b.data()[0] == 2 && b.data()[1] == 1);
+
+    CHECK(!b.parse(""));
+    CHECK(!b.any());
+    CHECK(!b.parse(" \n"));
+    CHECK(!b.parse(0));
+    CHECK(b.parse("0\n"));
+    CHECK(!b.any());
+}
+
+static void test_bad_hex()
+{
+    Bitmap<64, uint32_t> b;
+    CHECK(!b.parse("12g4"));
+    CHECK(!b.any());
+    CHECK(!b.parse("0x10"));
+    CHECK(!b.parse("-1"));
+    // an error in any word clears what was parsed already
+    CHECK(!b.parse("z ffffffff"));
+    CHECK(!b.any());
+    CHECK(b.parse("aBcDeF"));
+    CHECK(b.data()[0] == 0xabcdef);
+}
+
+static void test_overlong()
+{
+    Bitmap<64, uint32_t> b32;
+    CHECK(b32.parse("ffffffff"));
+    CHECK(!b32.parse("1ffffffff"));
+    CHECK(!b32.any());
+    CHECK(!b32.parse("000000001"));
+
+    Bitmap<128, uint64_t> b64;
+    CHECK(b64.parse("ffffffffffffffff"));
+    CHECK(!b64.parse("1ffffffffffffffff"));
+    CHECK(!b64.any());
+}
+
+static void test_size_limits()
+{
+    // words and bits beyond the bitmap are dropped
+    Bitmap<40, uint32_t> b;
+    CHECK(b.parse("ffffffff 1 0"));
+    CHECK(b.test(32));
+    CHECK(!b.test(64));
+    CHECK(b.parse("ffffffff ffffffff"));
+    CHECK(b.data()[1] == 0xff);
+    CHECK(!b.test(40));
+
+    b.clear();
+    b.set(40);
+    CHECK(!b.any());
+    b.set(39);
+    CHECK(b.test(39));
+    b.reset(39);
+    CHECK(!b.any());
+
+    SwitchBits sw;
+    CHECK(sw.parse(sizeof(long) == 8 ? "ffffffffffffffff" : "ffffffff"));
+    CHECK(sw.test(SW_MAX));
+    CHECK(!sw.test(SW_MAX + 1));
+
+    CHECK(!b.test_range(5, 4));
+    CHECK(!b.test_range(0, 40));
+}
+
+int main()
+{
+    test_full_keyboard();
+    test_word_layout();
+    test_partial_row();
+    test_multi_word();
+    test_whitespace();
+    test_bad_hex();
+    test_overlong();
+    test_size_limits();
+
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
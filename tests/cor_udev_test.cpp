@@ -0,0 +1,208 @@
+/*
+ * Leak checks of the libudev wrappers
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: Denis Zalevskiy <denis.zalevskiy@jollamobile.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+// Built against tests/fake/libudev.h, which counts the objects alive:
+// every scope below must leave none behind and release nothing twice.
+
+#include <cor/udev.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                        \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                         \
+        }                                                       \
+    } while (0)
+
+#define CHECK_NO_LEAKS() do {                   \
+        CHECK(fake_udev::alive() == 0);         \
+        CHECK(fake_udev::bad_unrefs() == 0);    \
+    } while (0)
+
+using namespace cor::udev;
+
+static bool same(char const *a, char const *b)
+{
+    return a && b && !strcmp(a, b);
+}
+
+static void test_root()
+{
+    {
+        Root udev;
+        CHECK(udev);
+        CHECK(fake_udev::alive() == 1);
+    }
+    CHECK_NO_LEAKS();
+
+    {
+        Root a;
+        Root b(std::move(a));
+        CHECK(!a && b);
+        CHECK(fake_udev::alive() == 1);
+        b.reset();
+        CHECK(!b);
+        CHECK(fake_udev::alive() == 0);
+        b.reset();
+    }
+    CHECK_NO_LEAKS();
+}
+
+// the way the plugins look for input devices
+static void test_enumerate()
+{
+    {
+        Root udev;
+        Enumerate input(udev);
+        CHECK(input);
+        input.subsystem_add("input");
+        input.sysname_add("event*");
+        input.sysattr_add("capabilities/sw");
+        input.property_add("ID_INPUT", "1");
+
+        int count = 0, with_caps = 0;
+        auto check = [&](ListEntry const &e) -> bool {
+            Device event(udev, e.path());
+            CHECK(same(event.path(), e.path()));
+            CHECK(same(event.subsystem(), "input"));
+            CHECK(same(event.property("ID_INPUT"), "1"));
+            CHECK(event.devnode() != 0);
+            if (event.parent_with_subsystem("input").attr("capabilities/sw"))
+                ++with_caps;
+            ++count;
+            return true;
+        };
+        input.devices().for_each(check);
+        CHECK(count == 3);
+        CHECK(with_caps == 3);
+
+        // stops when fn returns false
+        count = 0;
+        input.devices().for_each([&count](ListEntry const &) -> bool {
+                return ++count < 2;
+            });
+        CHECK(count == 2);
+
+        // the enumeration keeps the root alive on its own
+        Enumerate moved(std::move(input));
+        CHECK(!input && moved);
+        udev.reset();
+        CHECK(fake_udev::alive() == 2);
+    }
+    CHECK_NO_LEAKS();
+}
+
+static void test_parent()
+{
+    {
+        Root udev;
+        Device parent;
+        {
+            Device event(udev, "/sys/devices/fake/input0/event0");
+            parent = event.parent_with_subsystem("input");
+            CHECK(same(parent.sysname(), "input0"));
+            CHECK(same(parent.attr("capabilities/sw"), "1\n"));
+            CHECK(!event.parent_with_subsystem("platform"));
+        }
+        // the reference taken keeps it valid after the child is gone
+        CHECK(same(parent.path(), "/sys/devices/fake/input0"));
+        CHECK(!parent.parent_with_subsystem("input"));
+
+        // assigning over a device releases the old one
+        parent = Device(udev, "/sys/devices/fake/input1/event1");
+        CHECK(same(parent.sysname(), "event1"));
+        CHECK(fake_udev::alive() == 2);
+
+        // moving onto itself changes nothing
+        Device &self = parent;
+        parent = std::move(self);
+        CHECK(parent);
+        CHECK(fake_udev::alive() == 2);
+    }
+    CHECK_NO_LEAKS();
+
+    // everything on a null device is null, and has no parent
+    Device none;
+    CHECK(!none);
+    CHECK(!none.parent_with_subsystem("input"));
+    CHECK(!none.attr("x") && !none.property("x") && !none.path());
+    CHECK(!none.devnode() && !none.subsystem() && !none.sysname());
+    CHECK(!none.action());
+    CHECK_NO_LEAKS();
+}
+
+static void test_monitor()
+{
+    {
+        Root udev;
+        Monitor monitor(udev);
+        CHECK(monitor);
+        CHECK(monitor.subsystem_add("input"));
+        CHECK(monitor.enable());
+        CHECK(monitor.fd() >= 0);
+
+        fake_udev::queue_event("/sys/devices/fake/input2/event2");
+        fake_udev::queue_event("/sys/devices/fake/input0/event0");
+
+        std::vector<Device> devices;
+        while (true) {
+            Device d(monitor);
+            if (!d)
+                break;
+            CHECK(same(d.action(), "add"));
+            devices.push_back(std::move(d));
+            CHECK(!d);
+        }
+        CHECK(devices.size() == 2);
+        CHECK(same(devices[0].sysname(), "event2"));
+        CHECK(same(devices[1].sysname(), "event0"));
+
+        Monitor moved(std::move(monitor));
+        CHECK(!monitor && moved);
+        devices.erase(devices.begin());
+        CHECK(fake_udev::alive() == 3);
+    }
+    CHECK_NO_LEAKS();
+}
+
+int main()
+{
+    test_root();
+    test_enumerate();
+    test_parent();
+    test_monitor();
+
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
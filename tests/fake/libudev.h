@@ -0,0 +1,74 @@
+#ifndef _FAKE_LIBUDEV_H_
+#define _FAKE_LIBUDEV_H_
+/*
+ * Just enough of libudev for the cor/udev.hpp tests, implemented by
+ * fake_udev.cpp: the same declarations as the real header, plus
+ * counters of the objects alive.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct udev;
+struct udev_list_entry;
+struct udev_enumerate;
+struct udev_monitor;
+struct udev_device;
+
+struct udev *udev_new(void);
+struct udev *udev_ref(struct udev *udev);
+struct udev *udev_unref(struct udev *udev);
+
+struct udev_list_entry *udev_list_entry_get_next(struct udev_list_entry *list_entry);
+const char *udev_list_entry_get_name(struct udev_list_entry *list_entry);
+#define udev_list_entry_foreach(list_entry, first_entry)                \
+    for (list_entry = first_entry;                                      \
+         list_entry != NULL;                                            \
+         list_entry = udev_list_entry_get_next(list_entry))
+
+struct udev_enumerate *udev_enumerate_new(struct udev *udev);
+struct udev_enumerate *udev_enumerate_unref(struct udev_enumerate *udev_enumerate);
+int udev_enumerate_add_match_subsystem(struct udev_enumerate *udev_enumerate, const char *subsystem);
+int udev_enumerate_add_match_sysname(struct udev_enumerate *udev_enumerate, const char *sysname);
+int udev_enumerate_add_match_sysattr(struct udev_enumerate *udev_enumerate, const char *sysattr, const char *value);
+int udev_enumerate_add_match_property(struct udev_enumerate *udev_enumerate, const char *property, const char *value);
+int udev_enumerate_scan_devices(struct udev_enumerate *udev_enumerate);
+struct udev_list_entry *udev_enumerate_get_list_entry(struct udev_enumerate *udev_enumerate);
+
+struct udev_monitor *udev_monitor_new_from_netlink(struct udev *udev, const char *name);
+struct udev_monitor *udev_monitor_unref(struct udev_monitor *udev_monitor);
+int udev_monitor_filter_add_match_subsystem_devtype(struct udev_monitor *udev_monitor, const char *subsystem, const char *devtype);
+int udev_monitor_enable_receiving(struct udev_monitor *udev_monitor);
+int udev_monitor_get_fd(struct udev_monitor *udev_monitor);
+struct udev_device *udev_monitor_receive_device(struct udev_monitor *udev_monitor);
+
+struct udev_device *udev_device_new_from_syspath(struct udev *udev, const char *syspath);
+struct udev_device *udev_device_ref(struct udev_device *udev_device);
+struct udev_device *udev_device_unref(struct udev_device *udev_device);
+struct udev_device *udev_device_get_parent_with_subsystem_devtype(struct udev_device *udev_device, const char *subsystem, const char *devtype);
+const char *udev_device_get_sysattr_value(struct udev_device *udev_device, const char *sysattr);
+const char *udev_device_get_property_value(struct udev_device *udev_device, const char *key);
+const char *udev_device_get_syspath(struct udev_device *udev_device);
+const char *udev_device_get_devnode(struct udev_device *udev_device);
+const char *udev_device_get_subsystem(struct udev_device *udev_device);
+const char *udev_device_get_sysname(struct udev_device *udev_device);
+const char *udev_device_get_action(struct udev_device *udev_device);
+
+#ifdef __cplusplus
+}
+
+namespace fake_udev {
+
+/// objects created and not yet released
+int alive();
+/// unrefs of objects which were not alive
+int bad_unrefs();
+/// the monitor returns a device added with this path
+void queue_event(const char *syspath);
+
+}
+
+#endif
+
+#endif // _FAKE_LIBUDEV_H_
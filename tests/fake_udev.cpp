@@ -0,0 +1,280 @@
+/*
+ * Fake libudev for the cor/udev.hpp tests
+ *
+ * Copyright (C) 2012 Jolla Ltd.
+ * Contact: Denis Zalevskiy <denis.zalevskiy@jollamobile.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <libudev.h>
+
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+// Reference counted like the real thing; the tests check that all the
+// objects are gone in the end, and that nothing is released twice.
+// The devices are input event devices "/sys/devices/fake/inputN/eventN",
+// each with an "input" parent holding the capabilities.
+
+namespace {
+
+std::set<void const *> objects;
+int bad = 0;
+std::list<std::string> events;
+
+char const *paths[] = {
+    "/sys/devices/fake/input0/event0",
+    "/sys/devices/fake/input1/event1",
+    "/sys/devices/fake/input2/event2",
+};
+
+template <typename T>
+T *create()
+{
+    T *p = new T();
+    objects.insert(p);
+    return p;
+}
+
+template <typename T>
+T *ref(T *p)
+{
+    if (p)
+        ++p->refs;
+    return p;
+}
+
+template <typename T>
+T *unref(T *p)
+{
+    if (!p)
+        return 0;
+    if (!objects.count(p)) {
+        ++bad;
+        return 0;
+    }
+    if (--p->refs == 0) {
+        objects.erase(p);
+        delete p;
+    }
+    return 0;
+}
+
+}
+
+struct udev
+{
+    udev() : refs(1) {}
+    int refs;
+};
+
+struct udev_list_entry
+{
+    std::string name;
+    udev_list_entry *next;
+};
+
+struct udev_enumerate
+{
+    udev_enumerate() : refs(1), root(0) {}
+    ~udev_enumerate() { unref(root); }
+    int refs;
+    struct udev *root;
+    std::vector<udev_list_entry> entries;
+};
+
+struct udev_monitor
+{
+    udev_monitor() : refs(1), root(0), enabled(false) {}
+    ~udev_monitor() { unref(root); }
+    int refs;
+    struct udev *root;
+    bool enabled;
+};
+
+struct udev_device
+{
+    udev_device() : refs(1), root(0), parent(0) {}
+    ~udev_device() { unref(parent); unref(root); }
+    int refs;
+    struct udev *root;
+    udev_device *parent; ///< one reference owned by the child
+    std::string syspath, subsystem, sysname, devnode, action;
+};
+
+static udev_device *new_device(struct udev *root, std::string const &syspath)
+{
+    udev_device *d = create<udev_device>();
+    d->root = ref(root);
+    d->syspath = syspath;
+    d->sysname = syspath.substr(syspath.rfind('/') + 1);
+    if (d->sysname.compare(0, 5, "event") == 0) {
+        d->subsystem = "input";
+        d->devnode = "/dev/input/" + d->sysname;
+    } else if (d->sysname.compare(0, 5, "input") == 0) {
+        d->subsystem = "input";
+    }
+    return d;
+}
+
+extern "C" {
+
+struct udev *udev_new(void) { return create<struct udev>(); }
+struct udev *udev_ref(struct udev *p) { return ref(p); }
+struct udev *udev_unref(struct udev *p) { return unref(p); }
+
+struct udev_list_entry *udev_list_entry_get_next(struct udev_list_entry *e)
+{
+    return e->next;
+}
+
+const char *udev_list_entry_get_name(struct udev_list_entry *e)
+{
+    return e->name.c_str();
+}
+
+struct udev_enumerate *udev_enumerate_new(struct udev *root)
+{
+    udev_enumerate *p = create<udev_enumerate>();
+    p->root = ref(root);
+    return p;
+}
+
+struct udev_enumerate *udev_enumerate_unref(struct udev_enumerate *p)
+{
+    return unref(p);
+}
+
+int udev_enumerate_add_match_subsystem(struct udev_enumerate *, const char *) { return 0; }
+int udev_enumerate_add_match_sysname(struct udev_enumerate *, const char *) { return 0; }
+int udev_enumerate_add_match_sysattr(struct udev_enumerate *, const char *, const char *) { return 0; }
+int udev_enumerate_add_match_property(struct udev_enumerate *, const char *, const char *) { return 0; }
+
+int udev_enumerate_scan_devices(struct udev_enumerate *p)
+{
+    p->entries.clear();
+    for (unsigned i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+        udev_list_entry e = { paths[i], 0 };
+        p->entries.push_back(e);
+    }
+    for (unsigned i = 0; i + 1 < p->entries.size(); ++i)
+        p->entries[i].next = &p->entries[i + 1];
+    return 0;
+}
+
+struct udev_list_entry *udev_enumerate_get_list_entry(struct udev_enumerate *p)
+{
+    return p->entries.empty() ? 0 : &p->entries[0];
+}
+
+struct udev_monitor *udev_monitor_new_from_netlink(struct udev *root, const char *)
+{
+    udev_monitor *p = create<udev_monitor>();
+    p->root = ref(root);
+    return p;
+}
+
+struct udev_monitor *udev_monitor_unref(struct udev_monitor *p)
+{
+    return unref(p);
+}
+
+int udev_monitor_filter_add_match_subsystem_devtype(struct udev_monitor *, const char *, const char *)
+{
+    return 0;
+}
+
+int udev_monitor_enable_receiving(struct udev_monitor *p)
+{
+    p->enabled = true;
+    return 0;
+}
+
+int udev_monitor_get_fd(struct udev_monitor *p)
+{
+    return p->enabled ? 42 : -1;
+}
+
+struct udev_device *udev_monitor_receive_device(struct udev_monitor *p)
+{
+    if (!p->enabled || events.empty())
+        return 0;
+    udev_device *d = new_device(p->root, events.front());
+    d->action = "add";
+    events.pop_front();
+    return d;
+}
+
+struct udev_device *udev_device_new_from_syspath(struct udev *root, const char *syspath)
+{
+    return new_device(root, syspath);
+}
+
+struct udev_device *udev_device_ref(struct udev_device *p) { return ref(p); }
+struct udev_device *udev_device_unref(struct udev_device *p) { return unref(p); }
+
+struct udev_device *udev_device_get_parent_with_subsystem_devtype
+(struct udev_device *p, const char *subsystem, const char *)
+{
+    if (p->sysname.compare(0, 5, "event") != 0 || std::string(subsystem) != "input")
+        return 0;
+    if (!p->parent)
+        p->parent = new_device(p->root, p->syspath.substr(0, p->syspath.rfind('/')));
+    return p->parent;
+}
+
+const char *udev_device_get_sysattr_value(struct udev_device *p, const char *name)
+{
+    if (p->sysname.compare(0, 5, "input") == 0 && std::string(name) == "capabilities/sw")
+        return "1\n";
+    return 0;
+}
+
+const char *udev_device_get_property_value(struct udev_device *p, const char *key)
+{
+    if (p->subsystem == "input" && std::string(key) == "ID_INPUT")
+        return "1";
+    return 0;
+}
+
+static const char *str(std::string const &s)
+{
+    return s.empty() ? 0 : s.c_str();
+}
+
+const char *udev_device_get_syspath(struct udev_device *p) { return str(p->syspath); }
+const char *udev_device_get_devnode(struct udev_device *p) { return str(p->devnode); }
+const char *udev_device_get_subsystem(struct udev_device *p) { return str(p->subsystem); }
+const char *udev_device_get_sysname(struct udev_device *p) { return str(p->sysname); }
+const char *udev_device_get_action(struct udev_device *p) { return str(p->action); }
+
+}
+
+namespace fake_udev {
+
+int alive() { return objects.size(); }
+int bad_unrefs() { return bad; }
+void queue_event(const char *syspath) { events.push_back(syspath); }
+
+}